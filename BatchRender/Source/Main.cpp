@@ -0,0 +1,305 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless batch renderer: runs WAV/FLAC files straight through
+    Harmonicator9000AudioProcessor without a DAW or an audio device, as fast
+    as the CPU allows, several files at once.
+
+    Harmonicator9000BatchRender [options] <files or folders...>
+        --out <folder>         where the rendered files go (default ./rendered), files found
+                               in a folder keep their subfolders under it
+        --block-size <n>       samples per processBlock call (default 512)
+        --jobs <n>             files rendered at the same time (default: one per core)
+        --preset <file>        JSON object of parameter id -> value, e.g. { "oddHarmonics": 6.0 }
+        --param <id>=<value>   set one parameter, can be repeated, wins over the preset
+        --list-params          print the parameter ids and ranges then quit
+
+    Renders can afford more latency than live use, --param lookahead=2 gives the
+    filters the long render lookahead. The latency is trimmed off the output.
+    Multichannel files keep every channel, --param pitchTracking=1 lets each
+    channel follow its own note instead of the mix of all of them.
+    --param synthQuality=3 renders the synths 8x oversampled with the least
+    aliasing, its latency is trimmed off with the lookahead's.
+    Every file renders offline, so the pitch tracking runs its precise mode
+    (longer windows, an estimate every 64 samples, octave checks) on threads
+    that all the jobs share. Files carry no MIDI, so pitchSource stays on
+    Detected for batch renders.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include "../../Source/PluginProcessor.h"
+
+#define DEFAULT_BLOCK_SIZE 512
+
+//==============================================================================
+struct RenderSettings {
+    juce::File outputFolder;
+    int blockSize = DEFAULT_BLOCK_SIZE;
+    std::map<juce::String, float> parameters; //id -> value in the parameter's own units (dB, Hz, choice index)
+};
+
+//one file to render and where it goes under the output folder: its path relative to the folder it was found in
+//(so files with the same name in different subfolders don't land on each other), or just its name if given directly
+struct RenderInput {
+    juce::File file;
+    juce::String outputPath;
+};
+
+struct RenderResult {
+    bool ok = false;
+    juce::String message;
+    double audioSeconds = 0.0;
+    double renderSeconds = 0.0;
+};
+
+static std::mutex outputLock; //keeps lines from different render threads from interleaving
+
+static void printLine(const juce::String& line) {
+    std::lock_guard<std::mutex> lock(outputLock);
+    std::cout << line << std::endl;
+}
+
+//==============================================================================
+//set every requested parameter, values are in real units so they get mapped to 0..1 the same way the host would
+static juce::String applyParameters(Harmonicator9000AudioProcessor& processor, const RenderSettings& settings) {
+    for (const auto& [id, value] : settings.parameters) {
+        auto* parameter = processor.apvts.getParameter(id);
+        if (parameter == nullptr) {
+            return "unknown parameter '" + id + "' (try --list-params)";
+        }
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+    return {};
+}
+
+static RenderResult renderFile(const RenderInput& job, const RenderSettings& settings) {
+    const auto& input = job.file;
+    RenderResult result;
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(input));
+    if (reader == nullptr) {
+        result.message = "can't read this file";
+        return result;
+    }
+    const int numChannels = static_cast<int>(reader->numChannels);
+    const double sampleRate = reader->sampleRate;
+
+    //one processor per file, every instance keeps its own pitch and its own analysis worker
+    Harmonicator9000AudioProcessor processor;
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+    layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+    if (!processor.setBusesLayout(layout)) {
+        result.message = juce::String(numChannels) + " channel files aren't supported by the processor";
+        return result;
+    }
+    result.message = applyParameters(processor, settings);
+    if (result.message.isNotEmpty()) {
+        return result;
+    }
+    processor.setNonRealtime(true);
+    processor.setRateAndBufferSizeDetails(sampleRate, settings.blockSize);
+    processor.prepareToPlay(sampleRate, settings.blockSize);
+
+    //write the same format we read, at the same bit depth where the format allows it
+    auto outputFile = settings.outputFolder.getChildFile(job.outputPath);
+    outputFile.getParentDirectory().createDirectory();
+    auto* format = formats.findFormatForFileExtension(input.getFileExtension());
+    outputFile.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(outputFile);
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    if (format != nullptr && stream->openedOk()) {
+        writer.reset(format->createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(numChannels),
+            reader->bitsPerSample > 16 ? 24 : 16, {}, 0));
+    }
+    if (writer == nullptr) {
+        result.message = "can't write " + outputFile.getFullPathName();
+        return result;
+    }
+    stream.release(); //the writer owns it now
+
+    //run the whole file plus the processor's latency and ring out, dropping the latency off the front
+    //so the output lines up with the input
+    const auto latency = static_cast<juce::int64>(processor.getLatencySamples());
+    const auto tail = static_cast<juce::int64>(processor.getTailLengthSeconds() * sampleRate);
+    const auto totalToProcess = reader->lengthInSamples + latency + tail;
+    juce::AudioBuffer<float> buffer(numChannels, settings.blockSize);
+    juce::MidiBuffer midi;
+
+    auto start = juce::Time::getHighResolutionTicks();
+    for (juce::int64 position = 0; position < totalToProcess; position += settings.blockSize) {
+        const int numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(settings.blockSize), totalToProcess - position));
+        buffer.setSize(numChannels, numSamples, false, false, true);
+        //past the end of the file the reader fills with silence
+        reader->read(&buffer, 0, numSamples, position, true, true);
+        midi.clear();
+        processor.processBlock(buffer, midi);
+
+        const auto skip = juce::jlimit(static_cast<juce::int64>(0), static_cast<juce::int64>(numSamples), latency - position);
+        if (skip < numSamples) {
+            writer->writeFromAudioSampleBuffer(buffer, static_cast<int>(skip), numSamples - static_cast<int>(skip));
+        }
+    }
+    result.renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    processor.releaseResources();
+
+    result.audioSeconds = static_cast<double>(reader->lengthInSamples) / sampleRate;
+    result.ok = true;
+    return result;
+}
+
+//==============================================================================
+static bool parseArguments(const juce::StringArray& args, RenderSettings& settings, std::vector<RenderInput>& inputs, int& numJobs) {
+    std::map<juce::String, float> presetParameters, commandLineParameters;
+    settings.outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile("rendered");
+
+    for (int i = 0; i < args.size(); ++i) {
+        const auto& arg = args[i];
+        bool hasValue = i + 1 < args.size();
+        if (arg == "--out" && hasValue) {
+            settings.outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+        }
+        else if (arg == "--block-size" && hasValue) {
+            settings.blockSize = juce::jmax(1, args[++i].getIntValue());
+        }
+        else if (arg == "--jobs" && hasValue) {
+            numJobs = juce::jmax(1, args[++i].getIntValue());
+        }
+        else if (arg == "--preset" && hasValue) {
+            auto presetFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            auto preset = juce::JSON::parse(presetFile.loadFileAsString());
+            auto* object = preset.getDynamicObject();
+            if (object == nullptr) {
+                std::cerr << "preset " << presetFile.getFullPathName() << " isn't a JSON object" << std::endl;
+                return false;
+            }
+            for (const auto& property : object->getProperties()) {
+                presetParameters[property.name.toString()] = static_cast<float>(static_cast<double>(property.value));
+            }
+        }
+        else if (arg == "--param" && hasValue) {
+            auto setting = args[++i];
+            if (!setting.containsChar('=')) {
+                std::cerr << "--param wants <id>=<value>, got " << setting << std::endl;
+                return false;
+            }
+            commandLineParameters[setting.upToFirstOccurrenceOf("=", false, false).trim()] =
+                setting.fromFirstOccurrenceOf("=", false, false).getFloatValue();
+        }
+        else if (arg.startsWith("--")) {
+            std::cerr << "unknown option " << arg << std::endl;
+            return false;
+        }
+        else {
+            //a file, or a folder we search for anything we can read
+            auto path = juce::File::getCurrentWorkingDirectory().getChildFile(arg);
+            if (path.isDirectory()) {
+                for (const auto& child : path.findChildFiles(juce::File::findFiles, true, "*.wav;*.flac")) {
+                    inputs.push_back({ child, child.getRelativePathFrom(path) });
+                }
+            }
+            else if (path.existsAsFile()) {
+                inputs.push_back({ path, path.getFileName() });
+            }
+            else {
+                std::cerr << "no such file " << path.getFullPathName() << std::endl;
+                return false;
+            }
+        }
+    }
+    //two inputs rendering to the same file would have two jobs writing it at once, refuse before anything starts
+    std::map<juce::String, juce::File> outputs;
+    for (const auto& input : inputs) {
+        const auto outputName = settings.outputFolder.getChildFile(input.outputPath).getFullPathName();
+        auto [existing, added] = outputs.emplace(outputName, input.file);
+        if (!added) {
+            std::cerr << input.file.getFullPathName() << " and " << existing->second.getFullPathName()
+                << " would both render to " << outputName << ", rename one or render them separately" << std::endl;
+            return false;
+        }
+    }
+    //the command line wins over the preset
+    settings.parameters = presetParameters;
+    for (const auto& [id, value] : commandLineParameters) {
+        settings.parameters[id] = value;
+    }
+    return true;
+}
+
+static void listParameters() {
+    Harmonicator9000AudioProcessor processor;
+    for (auto* parameter : processor.getParameters()) {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter)) {
+            auto range = ranged->getNormalisableRange();
+            std::cout << ranged->getParameterID() << "  (" << ranged->getName(64) << ", "
+                << range.start << " to " << range.end << ", default "
+                << range.convertFrom0to1(ranged->getDefaultValue()) << ")" << std::endl;
+        }
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; //the processor's parameters want a message manager around
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i) {
+        args.add(argv[i]);
+    }
+    if (args.contains("--list-params")) {
+        listParameters();
+        return 0;
+    }
+
+    RenderSettings settings;
+    std::vector<RenderInput> inputs;
+    int numJobs = juce::SystemStats::getNumCpus();
+    if (!parseArguments(args, settings, inputs, numJobs)) {
+        return 1;
+    }
+    if (inputs.empty()) {
+        std::cerr << "usage: Harmonicator9000BatchRender [--out <folder>] [--block-size <n>] [--jobs <n>] "
+            "[--preset <file.json>] [--param <id>=<value>]... [--list-params] <files or folders...>" << std::endl;
+        return 1;
+    }
+    settings.outputFolder.createDirectory();
+
+    //each render thread pulls the next file off the list until there are none left
+    std::atomic<int> nextInput{ 0 };
+    std::atomic<int> numFailed{ 0 };
+    std::vector<std::thread> renderThreads;
+    auto totalStart = juce::Time::getHighResolutionTicks();
+    const int numInputs = static_cast<int>(inputs.size());
+    for (int job = 0; job < juce::jmin(numJobs, numInputs); ++job) {
+        renderThreads.emplace_back([&] {
+            for (int index = nextInput++; index < numInputs; index = nextInput++) {
+                auto result = renderFile(inputs[index], settings);
+                if (result.ok) {
+                    printLine(inputs[index].outputPath + ": " + juce::String(result.audioSeconds, 1) + " s of audio in "
+                        + juce::String(result.renderSeconds, 2) + " s, "
+                        + juce::String(result.audioSeconds / juce::jmax(result.renderSeconds, 1.0e-9), 1) + "x real time");
+                }
+                else {
+                    numFailed++;
+                    printLine(inputs[index].outputPath + ": FAILED, " + result.message);
+                }
+            }
+        });
+    }
+    for (auto& thread : renderThreads) {
+        thread.join();
+    }
+    printLine("rendered " + juce::String(numInputs - numFailed.load()) + "/" + juce::String(numInputs) + " files in "
+        + juce::String(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - totalStart), 2)
+        + " s to " + settings.outputFolder.getFullPathName());
+    return numFailed.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,606 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Console benchmarks for the Harmonicator9000 DSP. Build the Release
+    configuration and run it from a terminal, nothing here needs a host.
+
+    Harmonicator9000Benchmarks [--json <file>] [--seconds <n>]
+        --json <file>    where the machine readable results go (default ./benchmark-results.json)
+        --seconds <n>    seconds of audio pushed through processBlock per configuration (default 2)
+
+    The tables on stdout are for reading, the JSON file is what gets compared
+    between releases. Every timing is the best of BENCH_REPEATS runs so a
+    stray context switch doesn't show up as a regression.
+
+    This app is built with HARMONICATOR_RT_CHECKS=1, so every processBlock
+    call it makes is watched for allocations, locks and thread creation
+    (see RealtimeSafety.h). Any at all and it exits with 1 after listing
+    where they came from.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/AmdfKernel.h"
+#include "../../Source/RealtimeSafety.h"
+
+#define BENCH_SAMPLE_RATE 48000.0
+#define BENCH_WINDOWS_PER_NOTE 16 //windows timed at each test note
+#define BENCH_CORRECT_CENTS 50.0 //anything further off than this counts as a wrong note
+#define BENCH_REPEATS 3 //each timing is the best of this many runs
+#define BENCH_NOTE_FREQ 82.41 //low E, what processBlock gets fed
+#define BENCH_FILTER_UPDATES 1000 //updateFilters calls timed per run
+#define BENCH_RT_BLOCKS_PER_SETTING 64 //processBlock calls between parameter switches in the real time safety pass
+#define BENCH_SYNTH_RATE 44100.0 //where the synths alias worst, so where the oversampling gets used
+#define BENCH_SYNTH_BLOCK_SIZE 256
+
+//==============================================================================
+//the benchmark needs the processor's private stages one at a time, the processor names this struct as a friend
+struct ProcessorBenchmarkAccess {
+    //park the analysis workers so the benchmark owns the pitch window and the filters (all of it through lane 0)
+    static void stopWorker(Harmonicator9000AudioProcessor& p) { p.stopAnalysis(); }
+    static void loadWindow(Harmonicator9000AudioProcessor& p, const std::vector<float>& window) {
+        std::copy_n(window.begin(), juce::jmin(window.size(), static_cast<size_t>(p.analysisWindowSize)),
+            p.lanes[0]->largePitchArray.begin() + MAX_ANALYSIS_HOP);
+    }
+    static double getAnalysisRate(Harmonicator9000AudioProcessor& p) { return p.getSampleRate() / p.analysisFactor; }
+    static int getAnalysisWindowSize(Harmonicator9000AudioProcessor& p) { return p.analysisWindowSize; }
+    static void setDetector(Harmonicator9000AudioProcessor& p, int mode) { p.lanes[0]->detectorMode = mode; }
+    //the parameter for the audio thread's next snapshot, and lane 0's copy for updateFilters
+    static void setHarmonicCount(Harmonicator9000AudioProcessor& p, int count) {
+        auto* parameter = p.apvts.getParameter("harmonicCount");
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(count)));
+        p.getUserDefinedSettings(*p.lanes[0]);
+    }
+    static int getHarmonicsPerSide(int count) { return Harmonicator9000AudioProcessor::harmonicsPerSide[count]; }
+    static constexpr int numHarmonicCounts = Harmonicator9000AudioProcessor::numHarmonicCounts;
+    static void getFundamentalFrequency(Harmonicator9000AudioProcessor& p) { p.getFundamentalFrequency(*p.lanes[0]); }
+    static void setFundamental(Harmonicator9000AudioProcessor& p, float freq) { p.lanes[0]->fundamentalFreq = freq; }
+    static void updateFilters(Harmonicator9000AudioProcessor& p) { p.updateFilters(*p.lanes[0]); }
+    //after the knob snapshot, which would otherwise put the engine back to whatever the parameter says
+    static void setFilterEngine(Harmonicator9000AudioProcessor& p, int engine) {
+        p.updateBlockParameters();
+        p.filterEngine = engine;
+    }
+    static void applyLatestCoefficients(Harmonicator9000AudioProcessor& p) {
+        auto& lane = *p.lanes[0];
+        lane.coefficientBuffer.update();
+        p.applyCoefficients(lane, lane.coefficientBuffer.getReadBuffer());
+    }
+    static void processHarmonicBands(Harmonicator9000AudioProcessor& p, juce::AudioBuffer<float>& buffer) {
+        juce::dsp::AudioBlock<float> block(buffer);
+        p.processHarmonicBands(block);
+    }
+};
+
+//==============================================================================
+//a rough stand in for a DI bass: eight harmonics falling off as 1/n with random phases, a little decay and some noise
+static void fillBassSignal(std::vector<float>& window, double freq, double sampleRate, juce::Random& random,
+    double gain, double decayPerSecond) {
+    std::array<double, 8> phases;
+    for (auto& phase : phases) {
+        phase = random.nextFloat() * juce::MathConstants<double>::twoPi;
+    }
+    for (size_t i = 0; i < window.size(); ++i) {
+        double t = static_cast<double>(i) / sampleRate;
+        double sample = 0.0;
+        for (size_t harmonic = 0; harmonic < phases.size(); ++harmonic) {
+            double n = static_cast<double>(harmonic + 1);
+            sample += std::sin(juce::MathConstants<double>::twoPi * freq * n * t + phases[harmonic]) / n;
+        }
+        sample *= 0.5 * std::exp(-t * decayPerSecond);
+        sample += (random.nextFloat() - 0.5f) * 0.01f;
+        window[i] = static_cast<float>(sample * gain);
+    }
+}
+
+//one plucked note, scaled by 8 the same way the plugin gains up its analysis input
+static void fillBassWindow(std::vector<float>& window, double freq, double sampleRate, juce::Random& random) {
+    fillBassSignal(window, freq, sampleRate, random, 8.0, 3.0);
+}
+
+//best of BENCH_REPEATS runs of body, in seconds
+template <typename Body>
+static double timeBestOf(Body&& body) {
+    double best = std::numeric_limits<double>::max();
+    for (int rep = 0; rep < BENCH_REPEATS; ++rep) {
+        auto start = juce::Time::getHighResolutionTicks();
+        body();
+        best = juce::jmin(best, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+    }
+    return best;
+}
+
+//a processor ready to go at this rate and block size with the synths on or off, worker parked
+static std::unique_ptr<Harmonicator9000AudioProcessor> makeProcessor(double sampleRate, int blockSize, bool synthsOn) {
+    auto processor = std::make_unique<Harmonicator9000AudioProcessor>();
+    for (auto id : { "oddSynth", "evenSynth" }) {
+        auto* parameter = processor->apvts.getParameter(id);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(synthsOn ? -12.0f : -100.0f));
+    }
+    processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor->prepareToPlay(sampleRate, blockSize);
+    return processor;
+}
+
+//==============================================================================
+//cost per window and accuracy of every detector over the notes the plugin tracks, at one analysis rate
+static void runDetectorBenchmark(juce::DynamicObject& results, double sampleRate, int windowSize, const juce::String& key) {
+    std::cout << "Pitch detectors, " << windowSize << " sample window at " << sampleRate << " Hz, "
+        << MINIMUM_FREQ << "-" << MAX_FREQ << " Hz in semitone steps" << std::endl;
+    std::cout << "detector    us/window   correct   octave errs   misses   mean err (cents)   worst err (cents)" << std::endl;
+
+    std::vector<float> window(static_cast<size_t>(windowSize));
+    auto names = PitchDetector::getModeNames();
+    juce::Array<juce::var> rows;
+    for (int mode = 0; mode < static_cast<int>(PitchDetectorMode::numModes); ++mode) {
+        //the AMDF gets the same reference size and threshold the plugin gives it
+        std::unique_ptr<PitchDetector> detector;
+        if (mode == static_cast<int>(PitchDetectorMode::amdf)) {
+            detector = std::make_unique<AmdfPitchDetector>(SMALL_PITCH_ARRAY_SIZE, 8, static_cast<float>(PITCH_DETECTION_THRESH));
+        }
+        else {
+            detector = PitchDetector::create(static_cast<PitchDetectorMode>(mode));
+        }
+        detector->prepare(sampleRate, windowSize, MINIMUM_FREQ, MAX_FREQ);
+
+        juce::Random random(1234); //same notes, phases and noise for every detector
+        std::int64_t ticks = 0;
+        int numWindows = 0, numCorrect = 0, numOctave = 0, numMissed = 0;
+        double sumCents = 0.0, worstCents = 0.0;
+
+        for (int semitone = 0; ; ++semitone) {
+            double freq = MINIMUM_FREQ * std::pow(2.0, semitone / 12.0);
+            if (freq > MAX_FREQ) {
+                break;
+            }
+            for (int rep = 0; rep < BENCH_WINDOWS_PER_NOTE; ++rep) {
+                fillBassWindow(window, freq, sampleRate, random);
+                auto start = juce::Time::getHighResolutionTicks();
+                float period = detector->detectPeriod(window.data(), static_cast<int>(window.size()));
+                ticks += juce::Time::getHighResolutionTicks() - start;
+                numWindows++;
+
+                if (period <= 0.0f) {
+                    numMissed++;
+                    continue;
+                }
+                double cents = 1200.0 * std::log2((sampleRate / period) / freq);
+                //fold to the nearest octave so we can tell octave jumps apart from plain wrong notes
+                double octaves = std::round(cents / 1200.0);
+                if (std::abs(cents) <= BENCH_CORRECT_CENTS) {
+                    numCorrect++;
+                    sumCents += std::abs(cents);
+                    worstCents = juce::jmax(worstCents, std::abs(cents));
+                }
+                else if (octaves != 0.0 && std::abs(cents - octaves * 1200.0) <= BENCH_CORRECT_CENTS) {
+                    numOctave++;
+                }
+            }
+        }
+
+        double usPerWindow = juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6 / numWindows;
+        std::cout << names[mode].paddedRight(' ', 10) << "  "
+            << juce::String(usPerWindow, 1).paddedLeft(' ', 9) << "   "
+            << juce::String(numCorrect).paddedLeft(' ', 4) << "/" << numWindows << "   "
+            << juce::String(numOctave).paddedLeft(' ', 11) << "   "
+            << juce::String(numMissed).paddedLeft(' ', 6) << "   "
+            << juce::String(numCorrect > 0 ? sumCents / numCorrect : 0.0, 2).paddedLeft(' ', 16) << "   "
+            << juce::String(worstCents, 2).paddedLeft(' ', 17) << std::endl;
+
+        auto* row = new juce::DynamicObject();
+        row->setProperty("detector", names[mode]);
+        row->setProperty("usPerWindow", usPerWindow);
+        row->setProperty("windows", numWindows);
+        row->setProperty("correct", numCorrect);
+        row->setProperty("octaveErrors", numOctave);
+        row->setProperty("misses", numMissed);
+        row->setProperty("meanErrorCents", numCorrect > 0 ? sumCents / numCorrect : 0.0);
+        row->setProperty("worstErrorCents", worstCents);
+        rows.add(juce::var(row));
+    }
+    results.setProperty(key, rows);
+}
+
+//==============================================================================
+//the AMDF difference loop on its own, every instruction set this CPU can run against the scalar one
+static void runAmdfKernelBenchmark(juce::DynamicObject& results) {
+    const int numLags = LARGE_PITCH_ARRAY_SIZE - SMALL_PITCH_ARRAY_SIZE - 8;
+    std::vector<float> window(LARGE_PITCH_ARRAY_SIZE);
+    juce::Random random(1234);
+    fillBassWindow(window, 110.0, BENCH_SAMPLE_RATE, random);
+
+    std::vector<float> scalarSums(numLags), sums(numLags);
+    AmdfKernel::getFunction(AmdfKernel::Isa::scalar)(window.data(), window.data(), SMALL_PITCH_ARRAY_SIZE, 8, numLags, scalarSums.data());
+
+    std::cout << std::endl << "AMDF kernel, " << numLags << " lags x " << SMALL_PITCH_ARRAY_SIZE << " samples (best here: "
+        << AmdfKernel::getIsaName(AmdfKernel::getBestIsa()) << ")" << std::endl;
+    std::cout << "isa         us/window   speedup   max diff vs scalar" << std::endl;
+    double scalarUs = 0.0;
+    juce::Array<juce::var> rows;
+    for (int isa = 0; isa < static_cast<int>(AmdfKernel::Isa::numIsas); ++isa) {
+        auto kernel = AmdfKernel::getFunction(static_cast<AmdfKernel::Isa>(isa));
+        juce::String name(AmdfKernel::getIsaName(static_cast<AmdfKernel::Isa>(isa)));
+        if (kernel == nullptr) {
+            std::cout << name.paddedRight(' ', 10) << "  not supported on this CPU" << std::endl;
+            continue;
+        }
+        auto start = juce::Time::getHighResolutionTicks();
+        for (int rep = 0; rep < BENCH_WINDOWS_PER_NOTE * 4; ++rep) {
+            kernel(window.data(), window.data(), SMALL_PITCH_ARRAY_SIZE, 8, numLags, sums.data());
+        }
+        double us = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1.0e6
+            / (BENCH_WINDOWS_PER_NOTE * 4);
+        if (isa == static_cast<int>(AmdfKernel::Isa::scalar)) {
+            scalarUs = us;
+        }
+        float maxDiff = 0.0f;
+        for (int lag = 0; lag < numLags; ++lag) {
+            maxDiff = juce::jmax(maxDiff, std::abs(sums[lag] - scalarSums[lag]));
+        }
+        std::cout << name.paddedRight(' ', 10) << "  " << juce::String(us, 1).paddedLeft(' ', 9) << "   "
+            << juce::String(scalarUs / us, 1).paddedLeft(' ', 6) << "x   " << maxDiff << std::endl;
+
+        auto* row = new juce::DynamicObject();
+        row->setProperty("isa", name);
+        row->setProperty("usPerWindow", us);
+        row->setProperty("maxDiffVsScalar", maxDiff);
+        rows.add(juce::var(row));
+    }
+    results.setProperty("amdfKernel", rows);
+}
+
+//==============================================================================
+//the whole audio thread path, ns per sample frame at every block size and rate a host is likely to use
+static void runProcessBlockBenchmark(juce::DynamicObject& results, double secondsPerRun) {
+    const std::array<double, 6> sampleRates{ 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    const std::array<int, 9> blockSizes{ 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+
+    std::cout << std::endl << "processBlock, stereo, ns per sample frame (" << secondsPerRun << " s of audio per run)" << std::endl;
+    std::cout << "rate      synths";
+    for (auto blockSize : blockSizes) {
+        std::cout << juce::String(blockSize).paddedLeft(' ', 8);
+    }
+    std::cout << std::endl;
+
+    juce::Array<juce::var> rows;
+    for (auto sampleRate : sampleRates) {
+        //a second of sustained low E, looped, loud enough to hold the gate open
+        std::vector<float> input(static_cast<size_t>(sampleRate));
+        juce::Random random(1234);
+        fillBassSignal(input, BENCH_NOTE_FREQ, sampleRate, random, 1.0, 0.0);
+
+        for (bool synthsOn : { false, true }) {
+            std::cout << juce::String(sampleRate / 1000.0, 1).paddedRight(' ', 10) << (synthsOn ? "on    " : "off   ");
+            for (auto blockSize : blockSizes) {
+                auto processor = makeProcessor(sampleRate, blockSize, synthsOn);
+                juce::AudioBuffer<float> buffer(2, blockSize);
+                juce::MidiBuffer midi;
+                size_t readPosition = 0;
+                auto runBlocks = [&](int numBlocks) {
+                    for (int block = 0; block < numBlocks; ++block) {
+                        for (int channel = 0; channel < 2; ++channel) {
+                            auto* data = buffer.getWritePointer(channel);
+                            for (int i = 0; i < blockSize; ++i) {
+                                data[i] = input[(readPosition + i) % input.size()];
+                            }
+                        }
+                        readPosition = (readPosition + blockSize) % input.size();
+                        processor->processBlock(buffer, midi);
+                    }
+                };
+                //warm up offline so the analysis runs inline, locks on to the note and opens the gate before we time anything
+                processor->setNonRealtime(true);
+                runBlocks(juce::jmax(1, static_cast<int>(sampleRate * 0.5) / blockSize));
+                processor->setNonRealtime(false);
+
+                const int numBlocks = juce::jmax(1, static_cast<int>(sampleRate * secondsPerRun) / blockSize);
+                double seconds = timeBestOf([&] { runBlocks(numBlocks); });
+                double nsPerSample = seconds * 1.0e9 / (static_cast<double>(numBlocks) * blockSize);
+                processor->releaseResources();
+                std::cout << juce::String(nsPerSample, 1).paddedLeft(' ', 8) << std::flush;
+
+                auto* row = new juce::DynamicObject();
+                row->setProperty("sampleRate", sampleRate);
+                row->setProperty("blockSize", blockSize);
+                row->setProperty("synths", synthsOn);
+                row->setProperty("nsPerSample", nsPerSample);
+                row->setProperty("realTimeFactor", 1.0e9 / (nsPerSample * sampleRate));
+                rows.add(juce::var(row));
+            }
+            std::cout << std::endl;
+        }
+    }
+    results.setProperty("processBlock", rows);
+}
+
+//==============================================================================
+//getFundamentalFrequency() as the worker runs it, detector plus the stability checks, one window per call
+static void runFundamentalBenchmark(juce::DynamicObject& results) {
+    auto processor = makeProcessor(BENCH_SAMPLE_RATE, 512, false);
+    ProcessorBenchmarkAccess::stopWorker(*processor);
+    //the window is at the decimated analysis rate, the same one the worker would see
+    const double analysisRate = ProcessorBenchmarkAccess::getAnalysisRate(*processor);
+    const int windowSize = ProcessorBenchmarkAccess::getAnalysisWindowSize(*processor);
+    std::vector<float> window(static_cast<size_t>(windowSize));
+    juce::Random random(1234);
+    fillBassWindow(window, BENCH_NOTE_FREQ, analysisRate, random);
+    ProcessorBenchmarkAccess::loadWindow(*processor, window);
+
+    std::cout << std::endl << "getFundamentalFrequency, " << windowSize << " sample window at " << analysisRate << " Hz" << std::endl;
+    std::cout << "detector    us/window" << std::endl;
+    auto names = PitchDetector::getModeNames();
+    juce::Array<juce::var> rows;
+    for (int mode = 0; mode < static_cast<int>(PitchDetectorMode::numModes); ++mode) {
+        ProcessorBenchmarkAccess::setDetector(*processor, mode);
+        double seconds = timeBestOf([&] {
+            for (int rep = 0; rep < BENCH_WINDOWS_PER_NOTE; ++rep) {
+                ProcessorBenchmarkAccess::getFundamentalFrequency(*processor);
+            }
+        });
+        double usPerWindow = seconds * 1.0e6 / BENCH_WINDOWS_PER_NOTE;
+        std::cout << names[mode].paddedRight(' ', 10) << "  " << juce::String(usPerWindow, 1).paddedLeft(' ', 9) << std::endl;
+
+        auto* row = new juce::DynamicObject();
+        row->setProperty("detector", names[mode]);
+        row->setProperty("usPerWindow", usPerWindow);
+        rows.add(juce::var(row));
+    }
+    results.setProperty("getFundamentalFrequency", rows);
+}
+
+//==============================================================================
+//updateFilters() with the fundamental walking up the bass range so every call does the full set of designs
+static void runUpdateFiltersBenchmark(juce::DynamicObject& results) {
+    auto processor = makeProcessor(BENCH_SAMPLE_RATE, 512, false);
+    ProcessorBenchmarkAccess::stopWorker(*processor);
+    double seconds = timeBestOf([&] {
+        for (int rep = 0; rep < BENCH_FILTER_UPDATES; ++rep) {
+            ProcessorBenchmarkAccess::setFundamental(*processor,
+                static_cast<float>(MINIMUM_FREQ + (MAX_FREQ - MINIMUM_FREQ) * rep / BENCH_FILTER_UPDATES));
+            ProcessorBenchmarkAccess::updateFilters(*processor);
+        }
+    });
+    double usPerUpdate = seconds * 1.0e6 / BENCH_FILTER_UPDATES;
+    std::cout << std::endl << "updateFilters: " << juce::String(usPerUpdate, 2) << " us per call" << std::endl;
+
+    auto* row = new juce::DynamicObject();
+    row->setProperty("usPerCall", usPerUpdate);
+    results.setProperty("updateFilters", juce::var(row));
+}
+
+//==============================================================================
+//the harmonic peak filter bank (every cascade size, stereo) with nothing else around it
+static void runFilterCascadeBenchmark(juce::DynamicObject& results, double secondsPerRun) {
+    const std::array<int, 5> blockSizes{ 32, 128, 512, 1024, 4096 };
+    std::cout << std::endl << "Harmonic filter bank (stereo) at " << BENCH_SAMPLE_RATE << " Hz, ns per sample frame" << std::endl;
+    std::cout << "bands  block       biquad   state variable" << std::endl;
+
+    std::vector<float> input(static_cast<size_t>(BENCH_SAMPLE_RATE));
+    juce::Random random(1234);
+    fillBassSignal(input, BENCH_NOTE_FREQ, BENCH_SAMPLE_RATE, random, 1.0, 0.0);
+
+    juce::Array<juce::var> rows;
+    for (int count = 0; count < ProcessorBenchmarkAccess::numHarmonicCounts; ++count) {
+        const int numBands = 1 + 2 * ProcessorBenchmarkAccess::getHarmonicsPerSide(count);
+        for (auto blockSize : blockSizes) {
+            //engine 0 is the biquad bank, 1 the state variable bank (which retunes itself every SVF_UPDATE_INTERVAL samples)
+            std::array<double, 2> nsPerSample{};
+            for (int engine = 0; engine < 2; ++engine) {
+                auto processor = makeProcessor(BENCH_SAMPLE_RATE, blockSize, false);
+                ProcessorBenchmarkAccess::stopWorker(*processor);
+                ProcessorBenchmarkAccess::setHarmonicCount(*processor, count);
+                //real peaks on every band, not the all pass start up state
+                ProcessorBenchmarkAccess::setFundamental(*processor, static_cast<float>(BENCH_NOTE_FREQ));
+                ProcessorBenchmarkAccess::updateFilters(*processor);
+                ProcessorBenchmarkAccess::applyLatestCoefficients(*processor);
+                ProcessorBenchmarkAccess::setFilterEngine(*processor, engine);
+
+                juce::AudioBuffer<float> buffer(2, blockSize);
+                const int numBlocks = juce::jmax(1, static_cast<int>(BENCH_SAMPLE_RATE * secondsPerRun) / blockSize);
+                double seconds = timeBestOf([&] {
+                    size_t readPosition = 0;
+                    for (int block = 0; block < numBlocks; ++block) {
+                        for (int channel = 0; channel < 2; ++channel) {
+                            auto* data = buffer.getWritePointer(channel);
+                            for (int i = 0; i < blockSize; ++i) {
+                                data[i] = input[(readPosition + i) % input.size()];
+                            }
+                        }
+                        readPosition = (readPosition + blockSize) % input.size();
+                        ProcessorBenchmarkAccess::processHarmonicBands(*processor, buffer);
+                    }
+                });
+                nsPerSample[engine] = seconds * 1.0e9 / (static_cast<double>(numBlocks) * blockSize);
+            }
+            std::cout << juce::String(numBands).paddedRight(' ', 7) << juce::String(blockSize).paddedRight(' ', 7) << "  "
+                << juce::String(nsPerSample[0], 2).paddedLeft(' ', 9) << "  " << juce::String(nsPerSample[1], 2).paddedLeft(' ', 15) << std::endl;
+
+            auto* row = new juce::DynamicObject();
+            row->setProperty("bands", numBands);
+            row->setProperty("blockSize", blockSize);
+            row->setProperty("nsPerSample", nsPerSample[0]);
+            row->setProperty("svfNsPerSample", nsPerSample[1]);
+            rows.add(juce::var(row));
+        }
+    }
+    results.setProperty("filterCascade", rows);
+}
+
+//==============================================================================
+//what each synth quality costs on top of the rest of processBlock, and the latency it adds
+static void runSynthQualityBenchmark(juce::DynamicObject& results, double secondsPerRun) {
+    std::vector<float> input(static_cast<size_t>(BENCH_SYNTH_RATE));
+    juce::Random random(1234);
+    fillBassSignal(input, BENCH_NOTE_FREQ, BENCH_SYNTH_RATE, random, 1.0, 0.0);
+
+    std::cout << std::endl << "synth quality, stereo, " << BENCH_SYNTH_RATE / 1000.0 << " kHz, block "
+        << BENCH_SYNTH_BLOCK_SIZE << ", synths on" << std::endl;
+    std::cout << "quality       ns/sample  latency" << std::endl;
+    juce::Array<juce::var> rows;
+    auto processor = makeProcessor(BENCH_SYNTH_RATE, BENCH_SYNTH_BLOCK_SIZE, true);
+    auto* parameter = processor->apvts.getParameter("synthQuality");
+    juce::AudioBuffer<float> buffer(2, BENCH_SYNTH_BLOCK_SIZE);
+    juce::MidiBuffer midi;
+    size_t readPosition = 0;
+    auto runBlocks = [&](int numBlocks) {
+        for (int block = 0; block < numBlocks; ++block) {
+            for (int channel = 0; channel < 2; ++channel) {
+                auto* data = buffer.getWritePointer(channel);
+                for (int i = 0; i < BENCH_SYNTH_BLOCK_SIZE; ++i) {
+                    data[i] = input[(readPosition + i) % input.size()];
+                }
+            }
+            readPosition = (readPosition + BENCH_SYNTH_BLOCK_SIZE) % input.size();
+            processor->processBlock(buffer, midi);
+        }
+    };
+    for (int quality = 0; quality < parameter->getNumSteps(); ++quality) {
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(quality)));
+        //lock on and open the gate at this quality before timing anything
+        processor->setNonRealtime(true);
+        runBlocks(juce::jmax(1, static_cast<int>(BENCH_SYNTH_RATE * 0.5) / BENCH_SYNTH_BLOCK_SIZE));
+        processor->setNonRealtime(false);
+
+        const int numBlocks = juce::jmax(1, static_cast<int>(BENCH_SYNTH_RATE * secondsPerRun) / BENCH_SYNTH_BLOCK_SIZE);
+        double seconds = timeBestOf([&] { runBlocks(numBlocks); });
+        double nsPerSample = seconds * 1.0e9 / (static_cast<double>(numBlocks) * BENCH_SYNTH_BLOCK_SIZE);
+        const int latency = processor->getLatencySamples();
+        std::cout << parameter->getCurrentValueAsText().paddedRight(' ', 12) << juce::String(nsPerSample, 1).paddedLeft(' ', 11)
+            << juce::String(latency).paddedLeft(' ', 9) << std::endl;
+
+        auto* row = new juce::DynamicObject();
+        row->setProperty("quality", parameter->getCurrentValueAsText());
+        row->setProperty("nsPerSample", nsPerSample);
+        row->setProperty("latencySamples", latency);
+        rows.add(juce::var(row));
+    }
+    processor->releaseResources();
+    results.setProperty("synthQuality", rows);
+}
+
+//==============================================================================
+//processBlock through every setting that isn't on the panel, switched mid stream, with the synths on and blocks
+//both smaller and bigger than the host promised in prepareToPlay. Nothing is timed, this is here for the checker
+static void runRealtimeSafetyPass(juce::DynamicObject& results) {
+    const int preparedBlockSize = 256;
+    auto processor = makeProcessor(BENCH_SAMPLE_RATE, preparedBlockSize, true);
+    std::vector<float> input(static_cast<size_t>(BENCH_SAMPLE_RATE));
+    juce::Random random(1234);
+    fillBassSignal(input, BENCH_NOTE_FREQ, BENCH_SAMPLE_RATE, random, 1.0, 0.0);
+
+    juce::AudioBuffer<float> buffer(2, preparedBlockSize * 4);
+    juce::MidiBuffer midi;
+    size_t readPosition = 0;
+    int numBlocks = 0;
+    auto runBlocks = [&] {
+        for (int block = 0; block < BENCH_RT_BLOCKS_PER_SETTING; ++block) {
+            //mostly the promised size, now and then something odd or bigger
+            const int blockSize = block % 8 == 7 ? preparedBlockSize * 4 : (block % 8 == 3 ? 37 : preparedBlockSize);
+            buffer.setSize(2, blockSize, false, false, true);
+            for (int channel = 0; channel < 2; ++channel) {
+                auto* data = buffer.getWritePointer(channel);
+                for (int i = 0; i < blockSize; ++i) {
+                    data[i] = input[(readPosition + i) % input.size()];
+                }
+            }
+            readPosition = (readPosition + blockSize) % input.size();
+            //a bass line's worth of notes landing part way into the blocks, for the MIDI pitch sources
+            midi.clear();
+            if (block % 4 == 0) {
+                midi.addEvent(juce::MidiMessage::noteOn(1, 36 + block % 12, 0.8f), blockSize / 3);
+            }
+            else if (block % 4 == 2) {
+                midi.addEvent(juce::MidiMessage::noteOff(1, 36 + (block - 2) % 12), blockSize / 2);
+            }
+            processor->processBlock(buffer, midi);
+            numBlocks++;
+        }
+    };
+    for (auto id : { "pitchDetector", "analysisHop", "oscillatorMode", "lookahead", "filterEngine", "pitchTracking", "synthQuality", "harmonicCount", "pitchSource", "midiOut", "gateDetector" }) {
+        auto* parameter = processor->apvts.getParameter(id);
+        const int numChoices = parameter->getNumSteps();
+        for (int choice = 0; choice < numChoices; ++choice) {
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(choice)));
+            runBlocks();
+        }
+        parameter->setValueNotifyingHost(parameter->getDefaultValue());
+    }
+    processor->releaseResources();
+
+    std::cout << std::endl << "Real time safety, " << numBlocks << " processBlock calls through every hidden setting: ";
+    if (!RealtimeSafety::isEnabled()) {
+        std::cout << "not checked (built without HARMONICATOR_RT_CHECKS)" << std::endl;
+        return;
+    }
+    std::cout << RealtimeSafety::getNumViolations() << " violations" << std::endl;
+    results.setProperty("realtimeSafetyViolations", RealtimeSafety::getNumViolations());
+}
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; //the processor's parameters want a message manager around
+
+    auto jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile("benchmark-results.json");
+    double secondsPerRun = 2.0;
+    for (int i = 1; i < argc; ++i) {
+        juce::String arg(argv[i]);
+        if (arg == "--json" && i + 1 < argc) {
+            jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        }
+        else if (arg == "--seconds" && i + 1 < argc) {
+            secondsPerRun = juce::jmax(0.01, juce::String(argv[++i]).getDoubleValue());
+        }
+        else {
+            std::cerr << "usage: Harmonicator9000Benchmarks [--json <file>] [--seconds <n>]" << std::endl;
+            return 1;
+        }
+    }
+
+    //enough about the build and the machine to tell whether two result files are comparable
+    juce::DynamicObject::Ptr results = new juce::DynamicObject();
+    auto* environment = new juce::DynamicObject();
+    environment->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+    environment->setProperty("cpu", juce::SystemStats::getCpuModel());
+    environment->setProperty("cores", juce::SystemStats::getNumCpus());
+    environment->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    environment->setProperty("juce", juce::SystemStats::getJUCEVersion());
+    environment->setProperty("amdfIsa", juce::String(AmdfKernel::getIsaName(AmdfKernel::getBestIsa())));
+   #if JUCE_DEBUG
+    environment->setProperty("build", "Debug");
+   #else
+    environment->setProperty("build", "Release");
+   #endif
+    environment->setProperty("repeats", BENCH_REPEATS);
+    results->setProperty("environment", juce::var(environment));
+
+    //full rate next to the decimated rate the plugin actually analyses at
+    runDetectorBenchmark(*results, BENCH_SAMPLE_RATE, LARGE_PITCH_ARRAY_SIZE, "pitchDetectors");
+    std::cout << std::endl;
+    runDetectorBenchmark(*results, BENCH_SAMPLE_RATE / static_cast<int>(BENCH_SAMPLE_RATE / ANALYSIS_TARGET_RATE),
+        static_cast<int>(ANALYSIS_WINDOW_SECONDS * ANALYSIS_TARGET_RATE), "pitchDetectorsDecimated");
+    runAmdfKernelBenchmark(*results);
+    runFundamentalBenchmark(*results);
+    runUpdateFiltersBenchmark(*results);
+    runFilterCascadeBenchmark(*results, secondsPerRun);
+    runProcessBlockBenchmark(*results, secondsPerRun);
+    runSynthQualityBenchmark(*results, secondsPerRun);
+    runRealtimeSafetyPass(*results);
+
+    if (!jsonFile.replaceWithText(juce::JSON::toString(juce::var(results.get())))) {
+        std::cerr << "couldn't write " << jsonFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "results written to " << jsonFile.getFullPathName() << std::endl;
+
+    //the processBlock timings above were watched too, so this covers every rate and block size as well
+    if (RealtimeSafety::getNumViolations() > 0) {
+        std::cerr << std::endl << "FAILED: processBlock broke real time safety" << std::endl << RealtimeSafety::getReport();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    AmdfKernel.cpp
+
+  ==============================================================================
+*/
+
+#include "AmdfKernel.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ //gcc and clang need to be told a function may use instructions past the baseline, msvc just lets us
+ #if JUCE_GCC || JUCE_CLANG
+  #define AMDF_TARGET(isa) __attribute__((target(isa)))
+ #else
+  #define AMDF_TARGET(isa)
+ #endif
+#endif
+
+namespace AmdfKernel {
+
+//==============================================================================
+static void computeScalar(const float* reference, const float* window, int referenceSize,
+    int firstLag, int numLags, float* sums) noexcept {
+    for (int n = 0; n < numLags; ++n) {
+        const float* shifted = window + firstLag + n;
+        float accumDiff = 0;
+        for (int i = 0; i < referenceSize; ++i) {
+            accumDiff += std::abs(reference[i] - shifted[i]);
+        }
+        sums[n] = accumDiff;
+    }
+}
+
+#if JUCE_INTEL
+//==============================================================================
+//two registers of lags per pass so the adds of one can overlap the other
+AMDF_TARGET("sse2")
+static void computeSse2(const float* reference, const float* window, int referenceSize,
+    int firstLag, int numLags, float* sums) noexcept {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    int n = 0;
+    for (; n + 8 <= numLags; n += 8) {
+        const float* shifted = window + firstLag + n;
+        __m128 accA = _mm_setzero_ps();
+        __m128 accB = _mm_setzero_ps();
+        for (int i = 0; i < referenceSize; ++i) {
+            __m128 ref = _mm_set1_ps(reference[i]);
+            accA = _mm_add_ps(accA, _mm_and_ps(absMask, _mm_sub_ps(ref, _mm_loadu_ps(shifted + i))));
+            accB = _mm_add_ps(accB, _mm_and_ps(absMask, _mm_sub_ps(ref, _mm_loadu_ps(shifted + i + 4))));
+        }
+        _mm_storeu_ps(sums + n, accA);
+        _mm_storeu_ps(sums + n + 4, accB);
+    }
+    computeScalar(reference, window, referenceSize, firstLag + n, numLags - n, sums + n);
+}
+
+AMDF_TARGET("avx2")
+static void computeAvx2(const float* reference, const float* window, int referenceSize,
+    int firstLag, int numLags, float* sums) noexcept {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    int n = 0;
+    for (; n + 16 <= numLags; n += 16) {
+        const float* shifted = window + firstLag + n;
+        __m256 accA = _mm256_setzero_ps();
+        __m256 accB = _mm256_setzero_ps();
+        for (int i = 0; i < referenceSize; ++i) {
+            __m256 ref = _mm256_set1_ps(reference[i]);
+            accA = _mm256_add_ps(accA, _mm256_and_ps(absMask, _mm256_sub_ps(ref, _mm256_loadu_ps(shifted + i))));
+            accB = _mm256_add_ps(accB, _mm256_and_ps(absMask, _mm256_sub_ps(ref, _mm256_loadu_ps(shifted + i + 8))));
+        }
+        _mm256_storeu_ps(sums + n, accA);
+        _mm256_storeu_ps(sums + n + 8, accB);
+    }
+    //whatever is left is less than two registers, the sse2 version mops up
+    computeSse2(reference, window, referenceSize, firstLag + n, numLags - n, sums + n);
+}
+
+AMDF_TARGET("avx512f")
+static void computeAvx512(const float* reference, const float* window, int referenceSize,
+    int firstLag, int numLags, float* sums) noexcept {
+    int n = 0;
+    for (; n + 32 <= numLags; n += 32) {
+        const float* shifted = window + firstLag + n;
+        __m512 accA = _mm512_setzero_ps();
+        __m512 accB = _mm512_setzero_ps();
+        for (int i = 0; i < referenceSize; ++i) {
+            __m512 ref = _mm512_set1_ps(reference[i]);
+            accA = _mm512_add_ps(accA, _mm512_abs_ps(_mm512_sub_ps(ref, _mm512_loadu_ps(shifted + i))));
+            accB = _mm512_add_ps(accB, _mm512_abs_ps(_mm512_sub_ps(ref, _mm512_loadu_ps(shifted + i + 16))));
+        }
+        _mm512_storeu_ps(sums + n, accA);
+        _mm512_storeu_ps(sums + n + 16, accB);
+    }
+    computeAvx2(reference, window, referenceSize, firstLag + n, numLags - n, sums + n);
+}
+#endif
+
+//==============================================================================
+Function getFunction(Isa isa) noexcept {
+    switch (isa) {
+    case Isa::scalar:
+        return computeScalar;
+   #if JUCE_INTEL
+    case Isa::sse2:
+        return juce::SystemStats::hasSSE2() ? computeSse2 : nullptr;
+    case Isa::avx2:
+        return juce::SystemStats::hasAVX2() ? computeAvx2 : nullptr;
+    case Isa::avx512:
+        return juce::SystemStats::hasAVX512F() ? computeAvx512 : nullptr;
+   #endif
+    default:
+        return nullptr;
+    }
+}
+
+Isa getBestIsa() noexcept {
+    static const Isa best = [] {
+        for (int isa = static_cast<int>(Isa::numIsas) - 1; isa > 0; --isa) {
+            if (getFunction(static_cast<Isa>(isa)) != nullptr) {
+                return static_cast<Isa>(isa);
+            }
+        }
+        return Isa::scalar;
+    }();
+    return best;
+}
+
+const char* getIsaName(Isa isa) noexcept {
+    switch (isa) {
+    case Isa::sse2: return "SSE2";
+    case Isa::avx2: return "AVX2";
+    case Isa::avx512: return "AVX-512";
+    default: return "scalar";
+    }
+}
+
+void computeDifferences(const float* reference, const float* window, int referenceSize,
+    int firstLag, int numLags, float* sums) noexcept {
+    static const Function best = getFunction(getBestIsa());
+    best(reference, window, referenceSize, firstLag, numLags, sums);
+}
+
+}
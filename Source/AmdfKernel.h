@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    AmdfKernel.h
+
+    The inner loop of the AMDF: for a run of consecutive lags, the sum of
+    |reference[i] - window[i + lag]| over the reference. The vector versions
+    put neighbouring lags in neighbouring lanes, so every pass over the
+    reference does 4/8/16 lags at once off one broadcast and one unaligned
+    load. Each lane still adds its terms in the same order as the scalar
+    loop, so all versions give the same sums.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace AmdfKernel {
+
+//instruction sets we have a kernel for, best last
+enum class Isa {
+    scalar,
+    sse2,
+    avx2,
+    avx512,
+    numIsas
+};
+
+//sums[n] = sum over i < referenceSize of |reference[i] - window[i + firstLag + n]|, for n < numLags
+using Function = void (*)(const float* reference, const float* window, int referenceSize,
+    int firstLag, int numLags, float* sums) noexcept;
+
+//the kernel for one instruction set, nullptr if it isn't compiled in or this CPU can't run it
+Function getFunction(Isa isa) noexcept;
+//the fastest kernel this CPU can run (checked once, then cached)
+Isa getBestIsa() noexcept;
+const char* getIsaName(Isa isa) noexcept;
+
+//run the fastest kernel
+void computeDifferences(const float* reference, const float* window, int referenceSize,
+    int firstLag, int numLags, float* sums) noexcept;
+
+}
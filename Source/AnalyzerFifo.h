@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    AnalyzerFifo.h
+
+    The audio thread's side of the editor's spectrum analyzer: the input and
+    output of every block copied into a single producer, single consumer
+    FIFO that the analyzer drains on the message thread. Pushing is one
+    relaxed load while nobody is listening and a copy while someone is, it
+    never waits on the reader; if the reader falls behind, whatever doesn't
+    fit is dropped.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#define ANALYZER_FIFO_SIZE 16384 //samples of each stream that can wait for the analyzer, several frames even at 192k
+
+class AnalyzerFifo {
+public:
+    enum stream {
+        inputStream, //the dry input as it arrives
+        outputStream, //what we send back to the host
+        numStreams
+    };
+
+    //audio thread: copy a block of one stream in, a no-op while no analyzer is open
+    void push(int streamIndex, const float* samples, int numSamples) noexcept {
+        if (!active.load(std::memory_order_relaxed) || samples == nullptr) {
+            return;
+        }
+        auto& s = streams[streamIndex];
+        int start1, size1, start2, size2;
+        s.fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+        if (size1 > 0) {
+            juce::FloatVectorOperations::copy(s.data.data() + start1, samples, size1);
+        }
+        if (size2 > 0) {
+            juce::FloatVectorOperations::copy(s.data.data() + start2, samples + size1, size2);
+        }
+        s.fifo.finishedWrite(size1 + size2);
+    }
+
+    //reader: take up to maxSamples of a stream, returns how many it got
+    int pull(int streamIndex, float* dest, int maxSamples) noexcept {
+        auto& s = streams[streamIndex];
+        int start1, size1, start2, size2;
+        s.fifo.prepareToRead(juce::jmin(maxSamples, s.fifo.getNumReady()), start1, size1, start2, size2);
+        if (size1 > 0) {
+            juce::FloatVectorOperations::copy(dest, s.data.data() + start1, size1);
+        }
+        if (size2 > 0) {
+            juce::FloatVectorOperations::copy(dest + size1, s.data.data() + start2, size2);
+        }
+        s.fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+    //reader: start or stop the feed. Starting throws away whatever was left from the last time, reading it off
+    //rather than resetting so the audio thread can keep writing the whole time
+    void setActive(bool shouldBeActive) noexcept {
+        if (shouldBeActive) {
+            for (auto& s : streams) {
+                s.fifo.finishedRead(s.fifo.getNumReady());
+            }
+        }
+        active.store(shouldBeActive, std::memory_order_relaxed);
+    }
+
+private:
+    struct Stream {
+        juce::AbstractFifo fifo{ ANALYZER_FIFO_SIZE };
+        std::array<float, ANALYZER_FIFO_SIZE> data{};
+    };
+    std::array<Stream, numStreams> streams;
+    std::atomic<bool> active{ false };
+};
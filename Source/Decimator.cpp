@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    Decimator.cpp
+
+  ==============================================================================
+*/
+
+#include "Decimator.h"
+
+//==============================================================================
+void Decimator::prepare(int newFactor) {
+    factor = juce::jmax(1, newFactor);
+    numTaps = factor == 1 ? 1 : factor * DECIMATOR_TAPS_PER_PHASE;
+    taps.assign(static_cast<size_t>(numTaps), 1.0f);
+    if (factor > 1) {
+        //blackman windowed sinc, the transition band ends right at the new nyquist so nothing folds back below it
+        const double transition = 5.5 / numTaps;
+        const double cutoff = 0.5 / factor - 0.5 * transition;
+        const double centre = 0.5 * (numTaps - 1);
+        double sum = 0.0;
+        for (int n = 0; n < numTaps; ++n) {
+            double x = n - centre;
+            double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(juce::MathConstants<double>::twoPi * cutoff * x) / (juce::MathConstants<double>::pi * x);
+            double w = 0.42 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * n / (numTaps - 1))
+                + 0.08 * std::cos(2.0 * juce::MathConstants<double>::twoPi * n / (numTaps - 1));
+            taps[static_cast<size_t>(n)] = static_cast<float>(sinc * w);
+            sum += sinc * w;
+        }
+        //unity gain at dc
+        for (auto& tap : taps) {
+            tap = static_cast<float>(tap / sum);
+        }
+        std::reverse(taps.begin(), taps.end());
+    }
+    history.assign(static_cast<size_t>(2 * numTaps), 0.0f);
+    reset();
+}
+
+void Decimator::reset() noexcept {
+    std::fill(history.begin(), history.end(), 0.0f);
+    writePosition = 0;
+    phase = 0;
+}
+
+bool Decimator::pushSample(float input, float& output) noexcept {
+    history[writePosition] = input;
+    history[writePosition + numTaps] = input;
+    writePosition = writePosition + 1 == numTaps ? 0 : writePosition + 1;
+    if (++phase < factor) {
+        return false;
+    }
+    phase = 0;
+    //the oldest sample is at writePosition, the newest numTaps - 1 after it
+    const float* recent = history.data() + writePosition;
+    float sum = 0.0f;
+    for (int n = 0; n < numTaps; ++n) {
+        sum += taps[n] * recent[n];
+    }
+    output = sum;
+    return true;
+}
@@ -0,0 +1,37 @@
+/*
+  ==============================================================================
+
+    Decimator.h
+
+    Anti-alias low pass and downsample by a whole factor in one step, for
+    the pitch analysis which only cares about the bottom few kHz. Only every
+    factor-th output is ever computed, so each input sample costs
+    tapsPerPhase multiply-adds no matter how high the host rate is.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#define DECIMATOR_TAPS_PER_PHASE 24 //filter length per output sample, sets how steep the anti-alias filter is
+
+class Decimator {
+public:
+    //design the filter for this factor and clear the history (allocates)
+    void prepare(int factor);
+    void reset() noexcept;
+    int getFactor() const noexcept { return factor; }
+
+    //push one input sample, every factor-th call hands back a decimated sample in output and returns true
+    bool pushSample(float input, float& output) noexcept;
+
+private:
+    int factor = 1;
+    int numTaps = 1;
+    int writePosition = 0;
+    int phase = 0; //input samples since the last output
+    std::vector<float> taps; //windowed sinc, stored reversed so the newest sample lines up with taps[numTaps - 1]
+    std::vector<float> history; //every sample written twice, numTaps apart, so the last numTaps are always contiguous
+};
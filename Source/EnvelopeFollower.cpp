@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    EnvelopeFollower.cpp
+
+  ==============================================================================
+*/
+
+#include "EnvelopeFollower.h"
+
+juce::StringArray EnvelopeFollower::getModeNames() {
+    return { "Peak", "RMS" };
+}
+
+void EnvelopeFollower::prepare(double newSampleRate, int maximumBlockSize) {
+    sampleRate = newSampleRate;
+    detector.resize(static_cast<size_t>(juce::jmax(1, maximumBlockSize)));
+    channelScratch.resize(detector.size());
+    //force the coefficients to be worked out for the new rate
+    const float attack = attackMs;
+    const float release = releaseMs;
+    attackMs = releaseMs = -1.0f;
+    setTimes(juce::jmax(0.0f, attack), juce::jmax(0.0f, release));
+    reset();
+}
+
+void EnvelopeFollower::setTimes(float newAttackMs, float newReleaseMs) noexcept {
+    if (newAttackMs == attackMs && newReleaseMs == releaseMs) {
+        return;
+    }
+    attackMs = newAttackMs;
+    releaseMs = newReleaseMs;
+    //the level gets 1 - 1/e of the way to a new input in the given time, 0 ms follows instantly
+    auto coefficient = [this](float ms) {
+        return ms > 0.0f ? static_cast<float>(std::exp(-1000.0 / (ms * sampleRate))) : 0.0f;
+    };
+    attackCoef = coefficient(attackMs);
+    releaseCoef = coefficient(releaseMs);
+}
+
+void EnvelopeFollower::setMode(EnvelopeMode newMode) noexcept {
+    if (newMode == mode) {
+        return;
+    }
+    //the state is power in rms mode and amplitude in peak mode
+    state = newMode == EnvelopeMode::rms ? state * state : std::sqrt(state);
+    mode = newMode;
+}
+
+//==============================================================================
+float EnvelopeFollower::process(const float* const* channels, int numChannels, int numSamples) noexcept {
+    numSamples = juce::jmin(numSamples, static_cast<int>(detector.size()));
+    if (numSamples <= 0 || numChannels <= 0) {
+        return getLevel();
+    }
+    //rectify (or square) every channel and keep the loudest of each sample
+    auto detect = [this, numSamples](float* dest, const float* source) {
+        if (mode == EnvelopeMode::rms) {
+            juce::FloatVectorOperations::multiply(dest, source, source, numSamples);
+        }
+        else {
+            juce::FloatVectorOperations::abs(dest, source, numSamples);
+        }
+    };
+    detect(detector.data(), channels[0]);
+    for (int channel = 1; channel < numChannels; ++channel) {
+        detect(channelScratch.data(), channels[channel]);
+        juce::FloatVectorOperations::max(detector.data(), detector.data(), channelScratch.data(), numSamples);
+    }
+
+    //one pole towards each sample, the attack time going up and the release coming down
+    float level = state;
+    for (int i = 0; i < numSamples; ++i) {
+        const float input = detector[static_cast<size_t>(i)];
+        const float coef = input > level ? attackCoef : releaseCoef;
+        level = input + coef * (level - input);
+    }
+    state = level;
+    return getLevel();
+}
+
+float EnvelopeFollower::getLevel() const noexcept {
+    return mode == EnvelopeMode::rms ? std::sqrt(state) : state;
+}
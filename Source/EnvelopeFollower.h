@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    EnvelopeFollower.h
+
+    One pole peak or RMS level follower with separate attack and release,
+    run on the audio thread over each quantum of a lane's channels right
+    before its synths play. Rectifying (or squaring) and taking the loudest
+    channel run a whole quantum at a time with FloatVectorOperations, only
+    the one pole recursion itself goes sample by sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+enum class EnvelopeMode {
+    peak, //follows the rectified signal, reacts to the pluck
+    rms, //follows the squared signal, closer to how loud it sounds
+    numModes
+};
+
+class EnvelopeFollower {
+public:
+    static juce::StringArray getModeNames();
+
+    //room for a quantum of scratch (allocates), the level starts at silence
+    void prepare(double newSampleRate, int maximumBlockSize);
+    void reset() noexcept { state = 0.0f; }
+    //the coefficients are only worked out again when a time actually moves
+    void setTimes(float attackMs, float releaseMs) noexcept;
+    //a new mode carries the level over, so switching doesn't make the gate jump
+    void setMode(EnvelopeMode newMode) noexcept;
+
+    //follow numSamples of the loudest of the channels, returns the level (linear amplitude) at the end
+    float process(const float* const* channels, int numChannels, int numSamples) noexcept;
+    float getLevel() const noexcept;
+
+private:
+    double sampleRate = 48000.0;
+    EnvelopeMode mode = EnvelopeMode::peak;
+    float attackMs = -1.0f;
+    float releaseMs = -1.0f;
+    float attackCoef = 0.0f; //how much of the old state survives a sample, rising and falling
+    float releaseCoef = 0.0f;
+    float state = 0.0f; //amplitude, or power in rms mode
+    std::vector<float> detector; //the loudest channel's rectified (or squared) samples
+    std::vector<float> channelScratch;
+};
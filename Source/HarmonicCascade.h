@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    HarmonicCascade.h
+
+    The harmonic bands for a fixed number of odd and even harmonics, as both
+    a biquad bank and a state variable bank. Which harmonic every band sits
+    on is worked out at compile time and the sections are written out one
+    after another, so a cascade built for three of each carries and runs
+    exactly seven bands and nothing more. The processor holds one cascade of
+    every size behind the HarmonicCascade interface, made up front like the
+    pitch detectors, and picks one per block.
+
+    Bands run fundamental first, then the odd harmonics (3, 5, 7, ...), then
+    the even ones (2, 4, 6, ...). Coefficients come in indexed by harmonic
+    number so every size can read the same hand-off from the worker.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "HarmonicFilterBank.h"
+#include "SvfHarmonicBank.h"
+
+//b0, b1, b2, a1, a2 of one peak band (normalized like JUCE's Coefficients)
+using PeakCoefficients = std::array<float, 5>;
+
+//the harmonic the band at this position sits on, for a cascade with numOddHarmonics odd bands
+constexpr int getBandHarmonic(int band, int numOddHarmonics) noexcept {
+    return band == 0 ? 1 : (band <= numOddHarmonics ? 2 * band + 1 : 2 * (band - numOddHarmonics));
+}
+
+//true if a cascade with this many odd and even bands has one on this harmonic
+constexpr bool hasHarmonicBand(int harmonic, int numOddHarmonics, int numEvenHarmonics) noexcept {
+    return harmonic == 1 || (harmonic % 2 == 1 ? harmonic <= 2 * numOddHarmonics + 1 : harmonic <= 2 * numEvenHarmonics);
+}
+
+class HarmonicCascade {
+public:
+    virtual ~HarmonicCascade() = default;
+
+    //size both banks for this rate and channel count, every band starts out flat (allocates)
+    virtual void prepare(double sampleRate, int numChannels) = 0;
+    virtual void reset() noexcept = 0;
+    //the biquad bank's coefficients, byHarmonic[harmonic - 1], only the harmonics this cascade has are read
+    virtual void setCoefficients(const PeakCoefficients* byHarmonic) noexcept = 0;
+    //retune every state variable bell to the fundamental, with one linear gain for each group of bands
+    virtual void tuneSvf(float fundamental, float quality, float fundamentalGain, float oddGain, float evenGain) noexcept = 0;
+    //run the block through one bank or the other in place
+    virtual void processBiquads(juce::dsp::AudioBlock<float>& block) noexcept = 0;
+    virtual void processSvfs(juce::dsp::AudioBlock<float>& block) noexcept = 0;
+
+    //3, 4 or 8 odd and as many even harmonics (allocates, nullptr for any other count)
+    static std::unique_ptr<HarmonicCascade> create(int harmonicsPerSide);
+};
+
+template <int numOddHarmonics, int numEvenHarmonics>
+class HarmonicSeriesCascade : public HarmonicCascade {
+public:
+    static constexpr int numBands = 1 + numOddHarmonics + numEvenHarmonics;
+    static constexpr std::array<int, numBands> harmonics = [] {
+        std::array<int, numBands> bandHarmonics{};
+        for (int band = 0; band < numBands; ++band) {
+            bandHarmonics[band] = getBandHarmonic(band, numOddHarmonics);
+        }
+        return bandHarmonics;
+    }();
+
+    void prepare(double sampleRate, int numChannels) override {
+        biquads.prepare(numChannels);
+        svfs.prepare(sampleRate, numChannels);
+        reset();
+    }
+
+    void reset() noexcept override {
+        biquads.reset();
+        svfs.reset();
+    }
+
+    void setCoefficients(const PeakCoefficients* byHarmonic) noexcept override {
+        unrolled<numBands>([&](int band) {
+            biquads.setSection(band, byHarmonic[harmonics[band] - 1].data());
+        });
+    }
+
+    void tuneSvf(float fundamental, float quality, float fundamentalGain, float oddGain, float evenGain) noexcept override {
+        unrolled<numBands>([&](int band) {
+            const float gain = band == 0 ? fundamentalGain : (band <= numOddHarmonics ? oddGain : evenGain);
+            svfs.setSection(band, fundamental * static_cast<float>(harmonics[band]), quality, gain);
+        });
+    }
+
+    void processBiquads(juce::dsp::AudioBlock<float>& block) noexcept override { biquads.process(block); }
+    void processSvfs(juce::dsp::AudioBlock<float>& block) noexcept override { svfs.process(block); }
+
+private:
+    HarmonicFilterBank<numBands> biquads;
+    SvfHarmonicBank<numBands> svfs;
+};
+
+inline std::unique_ptr<HarmonicCascade> HarmonicCascade::create(int harmonicsPerSide) {
+    switch (harmonicsPerSide) {
+        case 3: return std::make_unique<HarmonicSeriesCascade<3, 3>>();
+        case 4: return std::make_unique<HarmonicSeriesCascade<4, 4>>();
+        case 8: return std::make_unique<HarmonicSeriesCascade<8, 8>>();
+        default: jassertfalse; return nullptr;
+    }
+}
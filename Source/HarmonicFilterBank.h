@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    HarmonicFilterBank.h
+
+    The harmonic peak filters as one cascade of numSections biquads that
+    runs every channel at once. Channels sit side by side in the lanes of a
+    juce::dsp::SIMDRegister (so stereo is one register with room to spare),
+    coefficients are kept broadcast across the lanes, one array per
+    coefficient, and the whole cascade runs per sample in a single pass over
+    the block. Same transposed direct form II maths as juce::dsp::IIR::Filter,
+    so the response is identical to chaining the separate filters. The
+    sections are written out by unrolled() rather than looped over, the
+    section count is a template argument so there is nothing to decide at
+    run time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//body(0), body(1) ... body(count - 1) written out one after another, so a cascade's sections unroll whatever the optimizer thinks
+template <int count, typename Body>
+inline void unrolled(Body&& body) noexcept {
+    [&]<int... index>(std::integer_sequence<int, index...>) {
+        (body(index), ...);
+    }(std::make_integer_sequence<int, count>{});
+}
+
+template <int numSections>
+class HarmonicFilterBank
+{
+public:
+    using Register = juce::dsp::SIMDRegister<float>;
+    static constexpr int lanes = static_cast<int>(Register::SIMDNumElements);
+
+    //size the state for this many channels, every section starts out as a straight wire (allocates)
+    void prepare(int newNumChannels) {
+        numChannels = juce::jmax(1, newNumChannels);
+        const int numGroups = (numChannels + lanes - 1) / lanes;
+        state.assign(static_cast<size_t>(numGroups * numSections), {});
+        const float wire[] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int section = 0; section < numSections; ++section) {
+            setSection(section, wire);
+        }
+    }
+
+    void reset() noexcept {
+        std::fill(state.begin(), state.end(), SectionState{});
+    }
+
+    //b0, b1, b2, a1, a2 for one section (normalized like JUCE's Coefficients), safe to call between blocks
+    void setSection(int section, const float* coefs) noexcept {
+        b0[section] = Register::expand(coefs[0]);
+        b1[section] = Register::expand(coefs[1]);
+        b2[section] = Register::expand(coefs[2]);
+        a1[section] = Register::expand(coefs[3]);
+        a2[section] = Register::expand(coefs[4]);
+    }
+
+    //run every channel of the block (up to the number prepared for) through the whole cascade in place
+    void process(juce::dsp::AudioBlock<float>& block) noexcept {
+        const int channelsToProcess = juce::jmin(numChannels, static_cast<int>(block.getNumChannels()));
+        const int numSamples = static_cast<int>(block.getNumSamples());
+        for (int group = 0; group * lanes < channelsToProcess; ++group) {
+            const int firstChannel = group * lanes;
+            const int groupChannels = juce::jmin(lanes, channelsToProcess - firstChannel);
+            float* channelData[lanes] = {};
+            for (int lane = 0; lane < groupChannels; ++lane) {
+                channelData[lane] = block.getChannelPointer(static_cast<size_t>(firstChannel + lane));
+            }
+            //pull the state into locals for the block so it can live in registers
+            SectionState* groupState = state.data() + group * numSections;
+            Register s1[numSections], s2[numSections];
+            for (int section = 0; section < numSections; ++section) {
+                s1[section] = groupState[section].s1;
+                s2[section] = groupState[section].s2;
+            }
+
+            alignas(Register::SIMDRegisterSize) float frame[lanes] = {};
+            for (int i = 0; i < numSamples; ++i) {
+                for (int lane = 0; lane < groupChannels; ++lane) {
+                    frame[lane] = channelData[lane][i];
+                }
+                Register sample = Register::fromRawArray(frame);
+                unrolled<numSections>([&](int section) {
+                    Register output = b0[section] * sample + s1[section];
+                    s1[section] = b1[section] * sample - a1[section] * output + s2[section];
+                    s2[section] = b2[section] * sample - a2[section] * output;
+                    sample = output;
+                });
+                sample.copyToRawArray(frame);
+                for (int lane = 0; lane < groupChannels; ++lane) {
+                    channelData[lane][i] = frame[lane];
+                }
+            }
+
+            //flush denormals out of the state once per block like IIR::Filter does
+            for (int section = 0; section < numSections; ++section) {
+                groupState[section].s1 = snapToZero(s1[section]);
+                groupState[section].s2 = snapToZero(s2[section]);
+            }
+        }
+    }
+
+private:
+    struct SectionState {
+        Register s1 = Register::expand(0.0f);
+        Register s2 = Register::expand(0.0f);
+    };
+
+    static Register snapToZero(Register value) noexcept {
+        for (size_t lane = 0; lane < Register::SIMDNumElements; ++lane) {
+            float laneValue = value.get(lane);
+            juce::dsp::util::snapToZero(laneValue);
+            value.set(lane, laneValue);
+        }
+        return value;
+    }
+
+    //coefficients broadcast into every lane, one array per coefficient
+    Register b0[numSections], b1[numSections], b2[numSections], a1[numSections], a2[numSections];
+    std::vector<SectionState> state; //[group][section], a group is one register's worth of channels
+    int numChannels = 0;
+};
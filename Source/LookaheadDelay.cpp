@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    LookaheadDelay.cpp
+
+  ==============================================================================
+*/
+
+#include "LookaheadDelay.h"
+
+void LookaheadDelay::prepare(int numChannels, int newMaximumDelay) {
+    maximumDelay = juce::jmax(0, newMaximumDelay);
+    //double the delay so there is always at least half a ring of room to write a run into
+    ringSize = juce::nextPowerOfTwo(juce::jmax(2, 2 * maximumDelay));
+    rings.assign(static_cast<size_t>(juce::jmax(1, numChannels)), std::vector<float>(static_cast<size_t>(ringSize), 0.0f));
+    delay = juce::jmin(delay, maximumDelay);
+    writePosition = 0;
+    fadePosition = LOOKAHEAD_CROSSFADE_SAMPLES;
+}
+
+void LookaheadDelay::reset() noexcept {
+    for (auto& ring : rings) {
+        std::fill(ring.begin(), ring.end(), 0.0f);
+    }
+    writePosition = 0;
+    fadePosition = LOOKAHEAD_CROSSFADE_SAMPLES; //nothing in flight to fade between
+}
+
+void LookaheadDelay::setDelay(int newDelay) noexcept {
+    newDelay = juce::jlimit(0, maximumDelay, newDelay);
+    if (newDelay == delay) {
+        return;
+    }
+    //fade from whichever tap the output is mostly on right now
+    if (fadePosition >= LOOKAHEAD_CROSSFADE_SAMPLES / 2) {
+        fadeFromDelay = delay;
+    }
+    delay = newDelay;
+    fadePosition = 0;
+}
+
+//==============================================================================
+void LookaheadDelay::process(juce::AudioBuffer<float>& buffer, int numChannels) noexcept {
+    const int numSamples = buffer.getNumSamples();
+    const int mask = ringSize - 1;
+    numChannels = juce::jmin(numChannels, buffer.getNumChannels(), static_cast<int>(rings.size()));
+    //any crossfade left over goes first, the rest of the block runs on the new tap alone
+    const int faded = fadePosition < LOOKAHEAD_CROSSFADE_SAMPLES ? processCrossfade(buffer, numChannels, numSamples) : 0;
+    for (int channel = 0; channel < numChannels; ++channel) {
+        float* data = buffer.getWritePointer(channel);
+        float* ring = rings[static_cast<size_t>(channel)].data();
+        int position = faded;
+        while (position < numSamples) {
+            //the longest run where neither the write nor the read wraps round the ring, and short enough
+            //that writing it can't land on samples the read still needs
+            const int write = (writePosition + position) & mask;
+            const int read = (write - delay) & mask;
+            const int run = juce::jmin(numSamples - position, ringSize - write, ringSize - read, ringSize - delay);
+            //in first then out, with a short delay the read picks up what was just written
+            std::copy_n(data + position, run, ring + write);
+            std::copy_n(ring + read, run, data + position);
+            position += run;
+        }
+    }
+    writePosition = (writePosition + numSamples) & mask;
+}
+
+int LookaheadDelay::processCrossfade(juce::AudioBuffer<float>& buffer, int numChannels, int numSamples) noexcept {
+    const int numToFade = juce::jmin(numSamples, LOOKAHEAD_CROSSFADE_SAMPLES - fadePosition);
+    const int mask = ringSize - 1;
+    for (int channel = 0; channel < numChannels; ++channel) {
+        float* data = buffer.getWritePointer(channel);
+        float* ring = rings[static_cast<size_t>(channel)].data();
+        for (int i = 0; i < numToFade; ++i) {
+            const int write = (writePosition + i) & mask;
+            ring[write] = data[i];
+            const float gain = static_cast<float>(fadePosition + i + 1) / LOOKAHEAD_CROSSFADE_SAMPLES;
+            const float from = ring[(write - fadeFromDelay) & mask];
+            const float to = ring[(write - delay) & mask];
+            data[i] = from + gain * (to - from);
+        }
+    }
+    fadePosition += numToFade;
+    return numToFade;
+}
@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    LookaheadDelay.h
+
+    Whole sample delay for the audio path so the pitch analysis (which runs
+    on the undelayed input) gets a head start on the notes it is retuning
+    the filters for. One ring per channel, sized for the longest delay up
+    front so the delay can change between blocks without allocating, and
+    copied in and out a run at a time rather than sample by sample. The
+    ring is written even with no delay so it always holds the latest input,
+    and a change of delay crossfades from the old tap to the new one over
+    LOOKAHEAD_CROSSFADE_SAMPLES instead of jumping.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#define LOOKAHEAD_CROSSFADE_SAMPLES 256 //how long a change of delay fades from the old tap to the new one
+
+class LookaheadDelay {
+public:
+    //size the rings for up to maximumDelay samples on this many channels (allocates)
+    void prepare(int numChannels, int maximumDelay);
+    //silence everything in flight
+    void reset() noexcept;
+
+    //samples the output runs behind the input, clamped to what we were prepared for. The output fades over to
+    //it from wherever it is now
+    void setDelay(int newDelay) noexcept;
+    int getDelay() const noexcept { return delay; }
+    int getMaximumDelay() const noexcept { return maximumDelay; }
+
+    //delay the first numChannels channels of the buffer in place, call it every block whatever the delay
+    void process(juce::AudioBuffer<float>& buffer, int numChannels) noexcept;
+
+private:
+    //sample by sample while a crossfade is running, returns how many samples it covered
+    int processCrossfade(juce::AudioBuffer<float>& buffer, int numChannels, int numSamples) noexcept;
+
+    int maximumDelay = 0;
+    int delay = 0;
+    int fadeFromDelay = 0; //the tap we are fading away from
+    int fadePosition = LOOKAHEAD_CROSSFADE_SAMPLES; //samples into the crossfade, done at LOOKAHEAD_CROSSFADE_SAMPLES
+    int ringSize = 1; //power of two, more than maximumDelay so a run can be written before it is read
+    int writePosition = 0;
+    std::vector<std::vector<float>> rings; //[channel][ringSize]
+};
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    OfflinePitchAnalysis.cpp
+
+  ==============================================================================
+*/
+
+#include "OfflinePitchAnalysis.h"
+#include <latch>
+
+void OfflinePitchAnalysis::prepare(double analysisRate, int newWindowSize, float minFreq, float maxFreq) {
+    if (threads == nullptr) {
+        threads = std::make_unique<juce::SharedResourcePointer<SharedThreads>>();
+    }
+    //the default detectors are tuned the same as the live ones
+    shareDetectors.resize(static_cast<size_t>((*threads)->pool.getNumThreads() + 1));
+    for (auto& detectors : shareDetectors) {
+        for (int mode = 0; mode < static_cast<int>(PitchDetectorMode::numModes); ++mode) {
+            auto& detector = detectors[static_cast<size_t>(mode)];
+            if (detector == nullptr) {
+                detector = PitchDetector::create(static_cast<PitchDetectorMode>(mode));
+            }
+            detector->prepare(analysisRate, newWindowSize, minFreq, maxFreq);
+        }
+    }
+    windowSize = newWindowSize;
+    windows.assign(static_cast<size_t>(OFFLINE_MAX_WINDOWS * windowSize), 0.0f);
+    minPeriod = juce::jmax(1, static_cast<int>(std::floor(analysisRate / maxFreq)));
+    maxPeriod = static_cast<int>(std::ceil(analysisRate / minFreq));
+    numWindows = 0;
+    prepared = true;
+}
+
+float* OfflinePitchAnalysis::addWindow() noexcept {
+    if (isFull()) {
+        return nullptr;
+    }
+    return windows.data() + numWindows++ * windowSize;
+}
+
+//==============================================================================
+void OfflinePitchAnalysis::analyse(PitchDetectorMode mode) {
+    if (numWindows == 0) {
+        return;
+    }
+    //no point waking more threads than there are windows, the render thread takes share 0 itself
+    const int numShares = juce::jmin(numWindows, static_cast<int>(shareDetectors.size()));
+    std::latch sharesDone(numShares - 1);
+    for (int share = 1; share < numShares; ++share) {
+        (*threads)->pool.addJob([this, share, numShares, mode, &sharesDone] {
+            runShare(share, numShares, mode);
+            sharesDone.count_down();
+        });
+    }
+    runShare(0, numShares, mode);
+    sharesDone.wait();
+}
+
+void OfflinePitchAnalysis::runShare(int share, int numShares, PitchDetectorMode mode) noexcept {
+    auto& detector = *shareDetectors[static_cast<size_t>(share)][static_cast<size_t>(mode)];
+    for (int index = share; index < numWindows; index += numShares) {
+        const float* window = windows.data() + index * windowSize;
+        auto& result = results[static_cast<size_t>(index)];
+        const auto start = juce::Time::getHighResolutionTicks();
+        const float period = detector.detectPeriod(window, windowSize);
+        result.period = period > 0.0f ? correctOctave(window, period) : 0.0f;
+        result.runTicks = juce::Time::getHighResolutionTicks() - start;
+    }
+}
+
+float OfflinePitchAnalysis::correctOctave(const float* window, float period) const noexcept {
+    const float atPeriod = getSelfSimilarity(window, juce::roundToInt(period));
+    //locked on to the octave below: half the period repeats about as well as the whole one
+    const int half = juce::roundToInt(period * 0.5f);
+    if (half >= minPeriod && atPeriod > 0.0f && getSelfSimilarity(window, half) >= OFFLINE_OCTAVE_MATCH * atPeriod) {
+        return period * 0.5f;
+    }
+    //locked on to the second harmonic: the period found repeats noticeably worse than twice it
+    const int twice = juce::roundToInt(period * 2.0f);
+    if (twice <= maxPeriod && atPeriod < OFFLINE_OCTAVE_MATCH * getSelfSimilarity(window, twice)) {
+        return period * 2.0f;
+    }
+    return period;
+}
+
+float OfflinePitchAnalysis::getSelfSimilarity(const float* window, int lag) const noexcept {
+    if (lag <= 0 || lag >= windowSize) {
+        return 0.0f;
+    }
+    float cross = 0.0f;
+    float energy = 0.0f;
+    for (int i = 0; i < windowSize - lag; ++i) {
+        cross += window[i] * window[i + lag];
+        energy += window[i] * window[i] + window[i + lag] * window[i + lag];
+    }
+    return energy > 0.0f ? 2.0f * cross / energy : 0.0f;
+}
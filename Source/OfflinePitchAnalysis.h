@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    OfflinePitchAnalysis.h
+
+    The pitch analysis for when the host renders offline and there is no
+    deadline to keep. Windows are collected a hop apart into a batch, then
+    analyse() runs the detector over every one of them with the work split
+    between the render thread and a pool of threads shared by every instance
+    in the process, and only returns once the whole batch is done. Every
+    period found is checked an octave either side, the detectors now and
+    then lock on to the second harmonic or the octave below.
+
+    Nothing here is touched during live playback, the threads and detectors
+    are only made the first time an offline render needs them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PitchDetector.h"
+
+#define OFFLINE_MAX_WINDOWS 64 //windows collected before a batch has to be analysed
+#define OFFLINE_OCTAVE_MATCH 0.9f //an octave either side has to repeat at least this well (relative) to be taken instead
+
+class OfflinePitchAnalysis {
+public:
+    //detectors for every share of the work at this rate and window length (allocates, and starts the shared
+    //threads if no other instance has). Batches start empty
+    void prepare(double analysisRate, int newWindowSize, float minFreq, float maxFreq);
+    //forget the preparation, the next offline render prepares again (the sample rate may have changed)
+    void release() noexcept { prepared = false; }
+    bool isPrepared() const noexcept { return prepared; }
+    int getWindowSize() const noexcept { return windowSize; }
+
+    //room for the next window of the batch, nullptr if the batch is full and needs analysing first
+    float* addWindow() noexcept;
+    int getNumWindows() const noexcept { return numWindows; }
+    bool isFull() const noexcept { return numWindows == OFFLINE_MAX_WINDOWS; }
+
+    //detect every window in the batch with this detector, returns once all of them are done
+    void analyse(PitchDetectorMode mode);
+    //what analyse found for a window: octave checked period in samples (0 if nothing clear) and how long it took
+    float getPeriod(int window) const noexcept { return results[window].period; }
+    juce::int64 getRunTicks(int window) const noexcept { return results[window].runTicks; }
+    //empty the batch for the next one
+    void clear() noexcept { numWindows = 0; }
+
+private:
+    //the threads every instance hands its shares to, so several renders at once share the cores instead of each taking all of them
+    struct SharedThreads {
+        juce::ThreadPool pool{ juce::jmax(1, juce::SystemStats::getNumCpus() - 1) };
+    };
+    //one share of the batch: windows share, share + numShares, ... on that share's own detectors
+    void runShare(int share, int numShares, PitchDetectorMode mode) noexcept;
+    //the detected period, or half or twice it if that repeats about as well
+    float correctOctave(const float* window, float period) const noexcept;
+    //normalized correlation of the window with itself lag samples on, 1 for a perfect repeat
+    float getSelfSimilarity(const float* window, int lag) const noexcept;
+
+    struct WindowResult {
+        float period = 0.0f;
+        juce::int64 runTicks = 0;
+    };
+
+    std::unique_ptr<juce::SharedResourcePointer<SharedThreads>> threads;
+    //a full set of detectors for each share (the render thread's is share 0), so no two threads touch the same one
+    std::vector<std::array<std::unique_ptr<PitchDetector>, static_cast<size_t>(PitchDetectorMode::numModes)>> shareDetectors;
+    std::vector<float> windows; //OFFLINE_MAX_WINDOWS windows one after another
+    std::array<WindowResult, OFFLINE_MAX_WINDOWS> results;
+    int numWindows = 0;
+    int windowSize = 0;
+    int minPeriod = 1; //the periods of the highest and lowest note we track, in samples
+    int maxPeriod = 1;
+    bool prepared = false;
+};
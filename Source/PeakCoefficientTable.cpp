@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    PeakCoefficientTable.cpp
+
+  ==============================================================================
+*/
+
+#include "PeakCoefficientTable.h"
+
+//==============================================================================
+void PeakCoefficientTable::prepare(double sampleRate, float newMinFreq, float maxFreq, int newMaxHarmonic,
+    float quality, float newMaxGainDb) {
+    minFreq = newMinFreq;
+    maxGainDb = newMaxGainDb;
+    maxHarmonic = newMaxHarmonic;
+    numFreqSteps = static_cast<int>(std::ceil(1200.0 * std::log2(maxFreq / minFreq) / PEAK_TABLE_CENTS_PER_STEP)) + 1;
+    numGainSteps = static_cast<int>(std::round(2.0 * maxGainDb / PEAK_TABLE_DB_PER_STEP)) + 1;
+
+    //same maths as juce::dsp::IIR::Coefficients::makePeakFilter, split into its frequency and gain halves
+    cosTable.resize(static_cast<size_t>(maxHarmonic * numFreqSteps));
+    alphaTable.resize(cosTable.size());
+    for (int harmonic = 1; harmonic <= maxHarmonic; ++harmonic) {
+        for (int step = 0; step < numFreqSteps; ++step) {
+            double freq = harmonic * minFreq * std::pow(2.0, step * PEAK_TABLE_CENTS_PER_STEP / 1200.0);
+            double omega = juce::MathConstants<double>::twoPi * freq / sampleRate;
+            size_t index = static_cast<size_t>((harmonic - 1) * numFreqSteps + step);
+            cosTable[index] = static_cast<float>(-2.0 * std::cos(omega));
+            alphaTable[index] = freq < sampleRate / 2 ? static_cast<float>(std::sin(omega) / (quality * 2.0)) : -1.0f;
+        }
+    }
+    gainTable.resize(static_cast<size_t>(numGainSteps));
+    for (int step = 0; step < numGainSteps; ++step) {
+        double gainDb = -maxGainDb + step * PEAK_TABLE_DB_PER_STEP;
+        gainTable[static_cast<size_t>(step)] = static_cast<float>(std::sqrt(juce::Decibels::decibelsToGain(gainDb)));
+    }
+}
+
+int PeakCoefficientTable::getFreqIndex(float fundamental) const noexcept {
+    if (!(fundamental > minFreq)) {
+        return 0; //also catches nan
+    }
+    int step = juce::roundToInt(1200.0f * std::log2(fundamental / minFreq) / static_cast<float>(PEAK_TABLE_CENTS_PER_STEP));
+    return juce::jlimit(0, numFreqSteps - 1, step);
+}
+
+int PeakCoefficientTable::getGainIndex(float gainDb) const noexcept {
+    int step = juce::roundToInt((gainDb + maxGainDb) / static_cast<float>(PEAK_TABLE_DB_PER_STEP));
+    return juce::jlimit(0, numGainSteps - 1, step);
+}
+
+bool PeakCoefficientTable::getCoefficients(int harmonic, int freqIndex, int gainIndex, float* dest) const noexcept {
+    jassert(harmonic >= 1 && harmonic <= maxHarmonic);
+    size_t index = static_cast<size_t>((harmonic - 1) * numFreqSteps + freqIndex);
+    float alpha = alphaTable[index];
+    if (alpha < 0.0f) {
+        return false;
+    }
+    float c2 = cosTable[index];
+    float A = gainTable[static_cast<size_t>(gainIndex)];
+    float alphaTimesA = alpha * A;
+    float alphaOverA = alpha / A;
+    float a0Inverse = 1.0f / (1.0f + alphaOverA);
+    dest[0] = (1.0f + alphaTimesA) * a0Inverse;
+    dest[1] = c2 * a0Inverse;
+    dest[2] = (1.0f - alphaTimesA) * a0Inverse;
+    dest[3] = c2 * a0Inverse;
+    dest[4] = (1.0f - alphaOverA) * a0Inverse;
+    return true;
+}
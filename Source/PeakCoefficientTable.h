@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    PeakCoefficientTable.h
+
+    Peak filter coefficients for the harmonic bands without calling
+    makePeakFilter (and without its heap allocation). The RBJ peak design
+    splits into a part that only depends on frequency (cos and alpha of the
+    centre) and a part that only depends on gain (A), so instead of one huge
+    table of every frequency x gain we keep one table of each and combine
+    them with a handful of multiplies and one divide. Frequencies are
+    quantized to whole cents above the lowest fundamental, gains to 0.1 dB.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#define PEAK_TABLE_CENTS_PER_STEP 1.0 //fundamental resolution of the table
+#define PEAK_TABLE_DB_PER_STEP 0.1 //gain resolution of the table
+
+class PeakCoefficientTable {
+public:
+    //build the tables for fundamentals minFreq..maxFreq, harmonics 1..maxHarmonic and gains of +/- maxGainDb
+    //(allocates, call from prepareToPlay)
+    void prepare(double sampleRate, float minFreq, float maxFreq, int maxHarmonic, float quality, float maxGainDb);
+
+    //quantize a fundamental (Hz) and a band gain (dB) to table indexes, clamped into the table
+    int getFreqIndex(float fundamental) const noexcept;
+    int getGainIndex(float gainDb) const noexcept;
+
+    //b0, b1, b2, a1, a2 (normalized like JUCE's Coefficients) of the peak on this harmonic of the fundamental,
+    //returns false and leaves dest alone if that harmonic is at or above nyquist
+    bool getCoefficients(int harmonic, int freqIndex, int gainIndex, float* dest) const noexcept;
+
+private:
+    float minFreq = 40.0f;
+    float maxGainDb = 15.0f;
+    int numFreqSteps = 0;
+    int numGainSteps = 0;
+    int maxHarmonic = 0;
+    std::vector<float> cosTable; //-2 cos(omega), [harmonic - 1][freqIndex]
+    std::vector<float> alphaTable; //sin(omega) / 2Q, same layout, negative where the harmonic is past nyquist
+    std::vector<float> gainTable; //A = sqrt(linear gain), by gainIndex
+};
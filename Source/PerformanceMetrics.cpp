@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    PerformanceMetrics.cpp
+
+  ==============================================================================
+*/
+
+#include "PerformanceMetrics.h"
+#include <bit>
+
+void PerformanceMetrics::prepare(double newSampleRate) noexcept {
+    sampleRate = newSampleRate;
+    ticksPerSecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+    for (auto* counter : { &blocks, &blockTicks, &maxBlockTicks, &blockSamples, &gateOpenSamples, &gateClosedSamples,
+        &pitchRuns, &pitchRunTicks, &maxPitchRunTicks, &pitchLatencyTicks, &maxPitchLatencyTicks, &coefficientUpdates }) {
+        counter->store(0);
+    }
+    for (auto& bucket : blockHistogram) {
+        bucket.store(0);
+    }
+    lastCpuLoad = 0.0;
+    peakCpuLoad = 0.0;
+    lastHandoffTicks = 0;
+}
+
+//==============================================================================
+void PerformanceMetrics::recordBlock(juce::int64 ticks, int numSamples, bool gateOpen) noexcept {
+    const auto duration = static_cast<juce::uint64>(juce::jmax(static_cast<juce::int64>(0), ticks));
+    bump(blocks);
+    bump(blockTicks, duration);
+    raise(maxBlockTicks, duration);
+    bump(blockSamples, static_cast<juce::uint64>(numSamples));
+
+    //bucket by whole microseconds, each bucket twice as wide as the last
+    const auto micros = static_cast<juce::uint64>(static_cast<double>(duration) * 1.0e6 / ticksPerSecond);
+    const int bucket = juce::jmin(METRICS_HISTOGRAM_BUCKETS - 1, static_cast<int>(std::bit_width(micros)));
+    bump(blockHistogram[static_cast<size_t>(bucket)]);
+
+    if (numSamples > 0) {
+        const double load = (static_cast<double>(duration) / ticksPerSecond) / (numSamples / sampleRate);
+        lastCpuLoad.store(load, std::memory_order_relaxed);
+        if (load > peakCpuLoad.load(std::memory_order_relaxed)) {
+            peakCpuLoad.store(load, std::memory_order_relaxed);
+        }
+    }
+    bump(gateOpen ? gateOpenSamples : gateClosedSamples, static_cast<juce::uint64>(numSamples));
+}
+
+void PerformanceMetrics::recordPitchRun(juce::int64 runTicks, juce::int64 finishedTicks) noexcept {
+    const auto run = static_cast<juce::uint64>(juce::jmax(static_cast<juce::int64>(0), runTicks));
+    const auto latency = static_cast<juce::uint64>(juce::jmax(static_cast<juce::int64>(0),
+        finishedTicks - lastHandoffTicks.load(std::memory_order_relaxed)));
+    bump(pitchRuns);
+    bump(pitchRunTicks, run);
+    raise(maxPitchRunTicks, run);
+    bump(pitchLatencyTicks, latency);
+    raise(maxPitchLatencyTicks, latency);
+}
+
+//==============================================================================
+PerformanceMetrics::Snapshot PerformanceMetrics::getSnapshot() const noexcept {
+    Snapshot snapshot;
+    const double microsPerTick = 1.0e6 / ticksPerSecond;
+    snapshot.blocks = blocks.load(std::memory_order_relaxed);
+    if (snapshot.blocks > 0) {
+        snapshot.meanBlockMicros = static_cast<double>(blockTicks.load(std::memory_order_relaxed)) * microsPerTick / snapshot.blocks;
+    }
+    snapshot.maxBlockMicros = static_cast<double>(maxBlockTicks.load(std::memory_order_relaxed)) * microsPerTick;
+    const double audioSeconds = static_cast<double>(blockSamples.load(std::memory_order_relaxed)) / sampleRate;
+    if (audioSeconds > 0.0) {
+        snapshot.meanCpuLoad = static_cast<double>(blockTicks.load(std::memory_order_relaxed)) / ticksPerSecond / audioSeconds;
+    }
+    snapshot.lastCpuLoad = lastCpuLoad.load(std::memory_order_relaxed);
+    snapshot.peakCpuLoad = peakCpuLoad.load(std::memory_order_relaxed);
+    for (size_t bucket = 0; bucket < blockHistogram.size(); ++bucket) {
+        snapshot.blockHistogram[bucket] = blockHistogram[bucket].load(std::memory_order_relaxed);
+    }
+
+    snapshot.pitchRuns = pitchRuns.load(std::memory_order_relaxed);
+    if (snapshot.pitchRuns > 0) {
+        snapshot.meanPitchRunMicros = static_cast<double>(pitchRunTicks.load(std::memory_order_relaxed)) * microsPerTick / snapshot.pitchRuns;
+        snapshot.meanPitchLatencyMs = static_cast<double>(pitchLatencyTicks.load(std::memory_order_relaxed)) * microsPerTick
+            / 1000.0 / snapshot.pitchRuns;
+    }
+    snapshot.maxPitchRunMicros = static_cast<double>(maxPitchRunTicks.load(std::memory_order_relaxed)) * microsPerTick;
+    snapshot.maxPitchLatencyMs = static_cast<double>(maxPitchLatencyTicks.load(std::memory_order_relaxed)) * microsPerTick / 1000.0;
+    snapshot.coefficientUpdates = coefficientUpdates.load(std::memory_order_relaxed);
+    snapshot.gateOpenSeconds = static_cast<double>(gateOpenSamples.load(std::memory_order_relaxed)) / sampleRate;
+    snapshot.gateClosedSeconds = static_cast<double>(gateClosedSamples.load(std::memory_order_relaxed)) / sampleRate;
+    return snapshot;
+}
+
+//==============================================================================
+juce::String PerformanceMetrics::getCsvHeader() {
+    juce::StringArray columns{ "time", "blocks", "meanBlockUs", "maxBlockUs", "meanCpuLoad", "lastCpuLoad", "peakCpuLoad",
+        "pitchRuns", "meanPitchRunUs", "maxPitchRunUs", "meanPitchLatencyMs", "maxPitchLatencyMs",
+        "coefficientUpdates", "gateOpenSeconds", "gateClosedSeconds" };
+    for (int bucket = 0; bucket < METRICS_HISTOGRAM_BUCKETS; ++bucket) {
+        columns.add("blocksFrom" + juce::String(getBucketMicros(bucket), 0) + "us");
+    }
+    return columns.joinIntoString(",");
+}
+
+juce::String PerformanceMetrics::toCsvRow(const Snapshot& snapshot) {
+    juce::StringArray values{ juce::Time::getCurrentTime().toISO8601(true),
+        juce::String(static_cast<juce::int64>(snapshot.blocks)),
+        juce::String(snapshot.meanBlockMicros, 3), juce::String(snapshot.maxBlockMicros, 3),
+        juce::String(snapshot.meanCpuLoad, 5), juce::String(snapshot.lastCpuLoad, 5), juce::String(snapshot.peakCpuLoad, 5),
+        juce::String(static_cast<juce::int64>(snapshot.pitchRuns)),
+        juce::String(snapshot.meanPitchRunMicros, 3), juce::String(snapshot.maxPitchRunMicros, 3),
+        juce::String(snapshot.meanPitchLatencyMs, 3), juce::String(snapshot.maxPitchLatencyMs, 3),
+        juce::String(static_cast<juce::int64>(snapshot.coefficientUpdates)),
+        juce::String(snapshot.gateOpenSeconds, 3), juce::String(snapshot.gateClosedSeconds, 3) };
+    for (auto count : snapshot.blockHistogram) {
+        values.add(juce::String(static_cast<juce::int64>(count)));
+    }
+    return values.joinIntoString(",");
+}
+
+bool PerformanceMetrics::appendToCsv(const juce::File& file) const {
+    if (!file.existsAsFile() && !file.replaceWithText(getCsvHeader() + "\n")) {
+        return false;
+    }
+    return file.appendText(toCsvRow(getSnapshot()) + "\n");
+}
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    PerformanceMetrics.h
+
+    Per instance counters for how hard the plugin is working in a session:
+    processBlock time (as a histogram and as CPU load against the block's
+    real time length), how long pitch estimates take and how stale they are
+    when they land, how often the worker publishes new filter coefficients,
+    and how long the gate spends open and closed.
+
+    Every counter has exactly one writer (the audio thread or the analysis
+    worker), so recording is a few relaxed atomic loads and stores with no
+    read-modify-write and no waiting. Anyone can take a snapshot at any
+    time; the values in it may be a block apart from each other, which is
+    fine for a meter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#define METRICS_HISTOGRAM_BUCKETS 16 //processBlock time buckets: under 1 us, then doubling up to 16 ms and over
+#define METRICS_ALIGNMENT 64 //each writer's counters start on their own cache line
+
+class PerformanceMetrics {
+public:
+    //everything worked out into units a person wants to read
+    struct Snapshot {
+        juce::uint64 blocks = 0;
+        double meanBlockMicros = 0.0;
+        double maxBlockMicros = 0.0;
+        double meanCpuLoad = 0.0; //processBlock time over the audio time it covered, 1.0 is the whole budget
+        double lastCpuLoad = 0.0;
+        double peakCpuLoad = 0.0;
+        std::array<juce::uint64, METRICS_HISTOGRAM_BUCKETS> blockHistogram{};
+        juce::uint64 pitchRuns = 0;
+        double meanPitchRunMicros = 0.0; //the detector on its own
+        double maxPitchRunMicros = 0.0;
+        double meanPitchLatencyMs = 0.0; //newest input in the window -> estimate ready
+        double maxPitchLatencyMs = 0.0;
+        juce::uint64 coefficientUpdates = 0;
+        double gateOpenSeconds = 0.0;
+        double gateClosedSeconds = 0.0;
+    };
+
+    //start over for a new rate (message thread, audio and worker stopped)
+    void prepare(double sampleRate) noexcept;
+
+    //audio thread
+    void recordBlock(juce::int64 ticks, int numSamples, bool gateOpen) noexcept;
+    //the audio thread notes when it hands input over, so the worker can tell how old it is when an estimate lands
+    void recordHandoff(juce::int64 ticks) noexcept { lastHandoffTicks.store(ticks, std::memory_order_relaxed); }
+
+    //analysis worker
+    void recordPitchRun(juce::int64 runTicks, juce::int64 finishedTicks) noexcept;
+    void recordCoefficientUpdate() noexcept { bump(coefficientUpdates); }
+
+    //any thread
+    Snapshot getSnapshot() const noexcept;
+    //lower edge of a histogram bucket in microseconds, for labels
+    static double getBucketMicros(int bucket) noexcept { return bucket == 0 ? 0.0 : std::ldexp(1.0, bucket - 1); }
+
+    //one line of CSV per dump, appended so a whole show ends up in one file (message thread, writes to disk)
+    static juce::String getCsvHeader();
+    static juce::String toCsvRow(const Snapshot& snapshot);
+    bool appendToCsv(const juce::File& file) const;
+
+    //times a processBlock call from construction to destruction
+    class ScopedBlockTimer {
+    public:
+        ScopedBlockTimer(PerformanceMetrics& m, int samples, const bool& gate) noexcept
+            : metrics(m), numSamples(samples), gateOpen(gate), start(juce::Time::getHighResolutionTicks()) {}
+        ~ScopedBlockTimer() noexcept { metrics.recordBlock(juce::Time::getHighResolutionTicks() - start, numSamples, gateOpen); }
+    private:
+        PerformanceMetrics& metrics;
+        int numSamples;
+        const bool& gateOpen; //read at the end of the block, once the block has decided
+        juce::int64 start;
+    };
+
+private:
+    using Counter = std::atomic<juce::uint64>;
+    //single writer, so a plain load and store does the job of fetch_add without the locked instruction
+    static void bump(Counter& counter, juce::uint64 amount = 1) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+    static void raise(Counter& counter, juce::uint64 value) noexcept {
+        if (value > counter.load(std::memory_order_relaxed)) {
+            counter.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    double sampleRate = 48000.0;
+    double ticksPerSecond = 1.0;
+
+    //written by the audio thread
+    alignas(METRICS_ALIGNMENT) Counter blocks{ 0 };
+    Counter blockTicks{ 0 };
+    Counter maxBlockTicks{ 0 };
+    Counter blockSamples{ 0 };
+    std::atomic<double> lastCpuLoad{ 0.0 };
+    std::atomic<double> peakCpuLoad{ 0.0 };
+    std::array<Counter, METRICS_HISTOGRAM_BUCKETS> blockHistogram{};
+    Counter gateOpenSamples{ 0 };
+    Counter gateClosedSamples{ 0 };
+    std::atomic<juce::int64> lastHandoffTicks{ 0 };
+
+    //written by the analysis worker
+    alignas(METRICS_ALIGNMENT) Counter pitchRuns{ 0 };
+    Counter pitchRunTicks{ 0 };
+    Counter maxPitchRunTicks{ 0 };
+    Counter pitchLatencyTicks{ 0 };
+    Counter maxPitchLatencyTicks{ 0 };
+    Counter coefficientUpdates{ 0 };
+};
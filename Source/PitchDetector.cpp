@@ -0,0 +1,273 @@
+/*
+  ==============================================================================
+
+    PitchDetector.cpp
+
+  ==============================================================================
+*/
+
+#include "PitchDetector.h"
+#include "AmdfKernel.h"
+
+//==============================================================================
+//fit a parabola through three neighbouring points and return how far the true extreme sits from the middle one
+static float parabolicOffset(float left, float centre, float right) noexcept {
+    float denom = left - 2.0f * centre + right;
+    if (denom == 0.0f) {
+        return 0.0f;
+    }
+    return juce::jlimit(-0.5f, 0.5f, 0.5f * (left - right) / denom);
+}
+
+//smallest fft order whose size is at least numSamples
+static int fftOrderFor(int numSamples) noexcept {
+    int order = 1;
+    while ((1 << order) < numSamples) {
+        order++;
+    }
+    return order;
+}
+
+std::unique_ptr<PitchDetector> PitchDetector::create(PitchDetectorMode mode) {
+    switch (mode) {
+    case PitchDetectorMode::yin:
+        return std::make_unique<YinPitchDetector>();
+    case PitchDetectorMode::mcLeod:
+        return std::make_unique<McLeodPitchDetector>();
+    default:
+        return std::make_unique<AmdfPitchDetector>();
+    }
+}
+
+juce::StringArray PitchDetector::getModeNames() {
+    return { "AMDF", "YIN", "McLeod" };
+}
+
+//==============================================================================
+AmdfPitchDetector::AmdfPitchDetector(int referenceSize, int minimumOffset, float detectionThresh, double tunedSampleRate)
+    : tunedReferenceSize(referenceSize), tunedMinimumOffset(minimumOffset), tunedDetectionThresh(detectionThresh),
+    tunedSampleRate(tunedSampleRate), referenceSize(referenceSize), minimumOffset(minimumOffset),
+    detectionThresh(detectionThresh) {}
+
+void AmdfPitchDetector::prepare(double sampleRate, int windowSize, float minFreq, float maxFreq) {
+    //the AMDF works straight out of the window and the caller range checks the result, we only need room for the sums
+    juce::ignoreUnused(minFreq, maxFreq);
+    //keep the same reference length and offset in time, the threshold is on a sum so it scales with the reference
+    const double ratio = sampleRate / tunedSampleRate;
+    referenceSize = juce::jmax(4, juce::roundToInt(tunedReferenceSize * ratio));
+    minimumOffset = juce::jmax(2, juce::roundToInt(tunedMinimumOffset * ratio));
+    detectionThresh = tunedDetectionThresh * static_cast<float>(referenceSize) / static_cast<float>(tunedReferenceSize);
+    differences.assign(juce::jmax(0, windowSize - referenceSize), 0.0f);
+    leaving.assign(differences.size(), 0.0f);
+    entering.assign(differences.size(), 0.0f);
+    slidingValid = false;
+}
+
+float AmdfPitchDetector::detectPeriod(const float* window, int numSamples) noexcept {
+    //perform the autocorrelation, find the first strongest peak, the caller does the math to determine frequency
+    const int numLags = numSamples - referenceSize - minimumOffset;
+    jassert(numLags <= static_cast<int>(differences.size()));
+    if (numLags < 3 || numLags > static_cast<int>(differences.size())) {
+        return 0.0f;
+    }
+    //slide the reference (the start of the window) along the rest of it, every lag's sum in one vectorized pass
+    AmdfKernel::computeDifferences(window, window, referenceSize, minimumOffset, numLags, differences.data());
+    slidingValid = false;
+    return findDip(numLags);
+}
+
+float AmdfPitchDetector::detectPeriodSliding(const float* window, int numSamples, int hop) noexcept {
+    const int numLags = numSamples - referenceSize - minimumOffset;
+    //the update costs two hop long strips, only worth it while that is less than the whole reference, and
+    //once a window's worth of hops have gone by start over so rounding in the running sums can't build up
+    if (!slidingValid || 2 * hop >= referenceSize || hopsSinceRefresh * hop >= numSamples) {
+        float period = detectPeriod(window, numSamples);
+        slidingValid = numLags >= 3 && numLags <= static_cast<int>(differences.size());
+        hopsSinceRefresh = 0;
+        return period;
+    }
+    //the old reference started hop samples earlier, its first hop samples are gone and hop new ones joined the end
+    AmdfKernel::computeDifferences(window - hop, window - hop, hop, minimumOffset, numLags, leaving.data());
+    AmdfKernel::computeDifferences(window + referenceSize - hop, window + referenceSize - hop, hop,
+        minimumOffset, numLags, entering.data());
+    for (int lag = 0; lag < numLags; ++lag) {
+        differences[lag] += entering[lag] - leaving[lag];
+    }
+    hopsSinceRefresh++;
+    return findDip(numLags);
+}
+
+float AmdfPitchDetector::findDip(int numLags) const noexcept {
+    int minLag = -1;
+    float minVal = 999999999999; //some absurdly large number
+    std::array<float, 3> lastThree = { 0, 0, 0 };
+    for (int lag = 0; lag < numLags; ++lag) {
+        lastThree[2] = lastThree[1];
+        lastThree[1] = lastThree[0];
+        lastThree[0] = differences[lag];
+        //see if it is above the threshold and also is a peak
+        if ((lastThree[1] < minVal - detectionThresh) &&
+            (lastThree[2] > lastThree[1]) && (lastThree[0] > lastThree[1])) {
+            minLag = lag - 1;
+            minVal = lastThree[1];
+        }
+    }
+    if (minLag < 1) {
+        return 0.0f;
+    }
+    //the dip is always between two higher neighbours, so refine it between samples (matters at low analysis rates)
+    return static_cast<float>(minimumOffset + minLag)
+        + parabolicOffset(differences[minLag - 1], differences[minLag], differences[minLag + 1]);
+}
+
+//==============================================================================
+YinPitchDetector::YinPitchDetector(float threshold) : threshold(threshold) {}
+
+void YinPitchDetector::prepare(double sampleRate, int windowSize, float minFreq, float maxFreq) {
+    //the reference part of the window has to be at least as long as the longest lag, so cap the lag at half the window
+    maxLag = juce::jmin(juce::roundToInt(sampleRate / minFreq) + 1, windowSize / 2);
+    minLag = juce::jmax(2, static_cast<int>(sampleRate / maxFreq) - 1);
+    //a linear (not circular) correlation of the reference against the window fits in one window length
+    fft = std::make_unique<juce::dsp::FFT>(fftOrderFor(windowSize));
+    windowSpectrum.assign(2 * fft->getSize(), 0.0f);
+    referenceSpectrum.assign(2 * fft->getSize(), 0.0f);
+    difference.assign(maxLag + 2, 0.0f);
+}
+
+float YinPitchDetector::detectPeriod(const float* window, int numSamples) noexcept {
+    jassert(fft != nullptr && numSamples <= fft->getSize());
+    const int referenceSize = numSamples - maxLag;
+    if (fft == nullptr || referenceSize <= 0 || minLag >= maxLag - 1) {
+        return 0.0f;
+    }
+
+    //cross correlate the reference (first part of the window) with the whole window
+    std::fill(windowSpectrum.begin(), windowSpectrum.end(), 0.0f);
+    std::fill(referenceSpectrum.begin(), referenceSpectrum.end(), 0.0f);
+    std::copy(window, window + numSamples, windowSpectrum.begin());
+    std::copy(window, window + referenceSize, referenceSpectrum.begin());
+    fft->performRealOnlyForwardTransform(windowSpectrum.data());
+    fft->performRealOnlyForwardTransform(referenceSpectrum.data());
+    for (int bin = 0; bin < fft->getSize(); ++bin) {
+        //window * conj(reference), left in windowSpectrum
+        float wRe = windowSpectrum[2 * bin];
+        float wIm = windowSpectrum[2 * bin + 1];
+        float rRe = referenceSpectrum[2 * bin];
+        float rIm = -referenceSpectrum[2 * bin + 1];
+        windowSpectrum[2 * bin] = wRe * rRe - wIm * rIm;
+        windowSpectrum[2 * bin + 1] = wRe * rIm + wIm * rRe;
+    }
+    fft->performRealOnlyInverseTransform(windowSpectrum.data());
+    const float* correlation = windowSpectrum.data(); //correlation[lag] = sum of x[j] * x[j + lag] over the reference
+
+    //difference(lag) = energy of the reference + energy of the shifted part - 2 * correlation,
+    //the shifted energy is a running sum so the whole thing stays linear in the window size
+    float referenceEnergy = 0.0f;
+    for (int j = 0; j < referenceSize; ++j) {
+        referenceEnergy += window[j] * window[j];
+    }
+    float shiftedEnergy = referenceEnergy;
+    float runningSum = 0.0f;
+    difference[0] = 1.0f;
+    for (int lag = 1; lag <= maxLag; ++lag) {
+        shiftedEnergy += window[lag + referenceSize - 1] * window[lag + referenceSize - 1]
+            - window[lag - 1] * window[lag - 1];
+        float diff = juce::jmax(0.0f, referenceEnergy + shiftedEnergy - 2.0f * correlation[lag]);
+        runningSum += diff;
+        //cumulative mean normalization, keeps the short lags from always winning
+        difference[lag] = runningSum > 0.0f ? diff * static_cast<float>(lag) / runningSum : 1.0f;
+    }
+
+    //take the first dip under the threshold, then ride it down to the bottom
+    for (int lag = minLag; lag < maxLag; ++lag) {
+        if (difference[lag] < threshold) {
+            while (lag + 1 < maxLag && difference[lag + 1] < difference[lag]) {
+                lag++;
+            }
+            return static_cast<float>(lag) + parabolicOffset(difference[lag - 1], difference[lag], difference[lag + 1]);
+        }
+    }
+    return 0.0f; //nothing periodic enough in here
+}
+
+//==============================================================================
+McLeodPitchDetector::McLeodPitchDetector(float cutoff) : cutoff(cutoff) {}
+
+void McLeodPitchDetector::prepare(double sampleRate, int windowSize, float minFreq, float maxFreq) {
+    maxLag = juce::jmin(juce::roundToInt(sampleRate / minFreq) + 1, windowSize / 2);
+    minLag = juce::jmax(2, static_cast<int>(sampleRate / maxFreq) - 1);
+    //pad so the circular autocorrelation doesn't wrap around for any lag we look at
+    fft = std::make_unique<juce::dsp::FFT>(fftOrderFor(windowSize + maxLag));
+    spectrum.assign(2 * fft->getSize(), 0.0f);
+    nsdf.assign(maxLag + 2, 0.0f);
+}
+
+float McLeodPitchDetector::detectPeriod(const float* window, int numSamples) noexcept {
+    jassert(fft != nullptr && numSamples + maxLag <= fft->getSize());
+    if (fft == nullptr || numSamples <= maxLag + 1 || minLag >= maxLag - 1) {
+        return 0.0f;
+    }
+
+    //autocorrelation through the power spectrum
+    std::fill(spectrum.begin(), spectrum.end(), 0.0f);
+    std::copy(window, window + numSamples, spectrum.begin());
+    fft->performRealOnlyForwardTransform(spectrum.data());
+    for (int bin = 0; bin < fft->getSize(); ++bin) {
+        float re = spectrum[2 * bin];
+        float im = spectrum[2 * bin + 1];
+        spectrum[2 * bin] = re * re + im * im;
+        spectrum[2 * bin + 1] = 0.0f;
+    }
+    fft->performRealOnlyInverseTransform(spectrum.data());
+    const float* correlation = spectrum.data();
+
+    //normalize by the energy of the two overlapping parts, m(lag) drops two squared samples per step
+    float energy = 0.0f;
+    for (int j = 0; j < numSamples; ++j) {
+        energy += window[j] * window[j];
+    }
+    energy *= 2.0f;
+    for (int lag = 0; lag <= maxLag + 1; ++lag) {
+        nsdf[lag] = energy > 0.0f ? 2.0f * correlation[lag] / energy : 0.0f;
+        energy -= window[lag] * window[lag] + window[numSamples - 1 - lag] * window[numSamples - 1 - lag];
+    }
+
+    //key maxima: the highest point of each positive lobe after the first zero crossing
+    int lag = 1;
+    while (lag < maxLag && nsdf[lag] > 0.0f) {
+        lag++;
+    }
+    float highest = 0.0f;
+    int chosenLag = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        //first pass finds the highest key maximum, the second takes the first one close enough to it
+        int lobeStart = lag;
+        int bestLag = 0;
+        float bestVal = 0.0f;
+        for (int i = lobeStart; i < maxLag; ++i) {
+            if (nsdf[i] > 0.0f) {
+                if (nsdf[i] > bestVal && nsdf[i] >= nsdf[i - 1] && nsdf[i] >= nsdf[i + 1]) {
+                    bestLag = i;
+                    bestVal = nsdf[i];
+                }
+            }
+            if ((nsdf[i] <= 0.0f || i == maxLag - 1) && bestLag != 0) {
+                //end of a positive lobe
+                if (pass == 0) {
+                    highest = juce::jmax(highest, bestVal);
+                }
+                else if (bestLag >= minLag && bestVal >= cutoff * highest) {
+                    chosenLag = bestLag;
+                    break;
+                }
+                bestLag = 0;
+                bestVal = 0.0f;
+            }
+        }
+    }
+    //a weak best peak means there isn't really a note in there
+    if (chosenLag == 0 || highest < 0.5f) {
+        return 0.0f;
+    }
+    return static_cast<float>(chosenLag) + parabolicOffset(nsdf[chosenLag - 1], nsdf[chosenLag], nsdf[chosenLag + 1]);
+}
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    PitchDetector.h
+
+    The pitch detectors the analysis worker can pick between. Each one takes
+    a window of (gained up) input and hands back the period it found in
+    samples, fractional where the algorithm allows, or 0 if nothing clear
+    was found. Everything that allocates happens in prepare() so detectPeriod()
+    can run over and over without touching the heap.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//the detection algorithms, in the order they appear on the "pitchDetector" parameter
+enum class PitchDetectorMode {
+    amdf,
+    yin,
+    mcLeod,
+    numModes
+};
+
+class PitchDetector {
+public:
+    virtual ~PitchDetector() = default;
+
+    //size the work buffers for a window length and the pitch range we care about (not the audio thread)
+    virtual void prepare(double sampleRate, int windowSize, float minFreq, float maxFreq) = 0;
+    //look at numSamples of the window and return the period in samples, 0 if there is no clear pitch
+    virtual float detectPeriod(const float* window, int numSamples) noexcept = 0;
+    //same as detectPeriod for a window that has moved on hop samples since the last sliding call, window[-hop]
+    //to window[-1] must still hold the samples that just dropped off the front. Detectors that can update
+    //their last sums do, the rest just start over
+    virtual float detectPeriodSliding(const float* window, int numSamples, int hop) noexcept {
+        juce::ignoreUnused(hop);
+        return detectPeriod(window, numSamples);
+    }
+    //forget anything carried between sliding calls (the window jumped or the hop changed)
+    virtual void resetSliding() noexcept {}
+
+    //build one of the detectors by mode
+    static std::unique_ptr<PitchDetector> create(PitchDetectorMode mode);
+    //names for the parameter/benchmark, same order as PitchDetectorMode
+    static juce::StringArray getModeNames();
+};
+
+//==============================================================================
+//the original brute force average magnitude difference function: slides the first
+//referenceSize samples of the window along the rest of it and takes the first strong dip.
+//The three numbers are in samples at tunedSampleRate, prepare scales them to the rate it is given
+class AmdfPitchDetector : public PitchDetector {
+public:
+    AmdfPitchDetector(int referenceSize = 200, int minimumOffset = 8, float detectionThresh = 1.8f,
+        double tunedSampleRate = 48000.0);
+
+    void prepare(double sampleRate, int windowSize, float minFreq, float maxFreq) override;
+    float detectPeriod(const float* window, int numSamples) noexcept override;
+    float detectPeriodSliding(const float* window, int numSamples, int hop) noexcept override;
+    void resetSliding() noexcept override { slidingValid = false; }
+
+private:
+    //take the first strong dip out of the difference sums
+    float findDip(int numLags) const noexcept;
+
+    int tunedReferenceSize;
+    int tunedMinimumOffset;
+    float tunedDetectionThresh;
+    double tunedSampleRate;
+    //the above scaled to the rate we were prepared for
+    int referenceSize;
+    int minimumOffset; //start slightly offset because the first samples will obviously line up
+    float detectionThresh; //a dip must be at least this much deeper than the last one to count
+    std::vector<float> differences; //difference sum for every lag, filled by the AmdfKernel in one go
+    //sliding: the sums in differences belong to the last window, so a hop only needs the strip of reference
+    //that slid out taken off and the strip that slid in added on
+    std::vector<float> leaving;
+    std::vector<float> entering;
+    bool slidingValid = false;
+    int hopsSinceRefresh = 0;
+};
+
+//==============================================================================
+//YIN (de Cheveigne & Kawahara) with the difference function built from an FFT cross correlation
+class YinPitchDetector : public PitchDetector {
+public:
+    YinPitchDetector(float threshold = 0.15f);
+
+    void prepare(double sampleRate, int windowSize, float minFreq, float maxFreq) override;
+    float detectPeriod(const float* window, int numSamples) noexcept override;
+
+private:
+    float threshold; //cumulative mean normalized difference a dip must get under to be taken
+    int minLag = 0;
+    int maxLag = 0;
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> windowSpectrum; //fft of the whole window
+    std::vector<float> referenceSpectrum; //fft of the first (window - maxLag) samples
+    std::vector<float> difference; //cumulative mean normalized difference, indexed by lag
+};
+
+//==============================================================================
+//McLeod pitch method: normalized square difference function from an FFT autocorrelation,
+//then the first "key maximum" that is close enough to the highest one
+class McLeodPitchDetector : public PitchDetector {
+public:
+    McLeodPitchDetector(float cutoff = 0.9f);
+
+    void prepare(double sampleRate, int windowSize, float minFreq, float maxFreq) override;
+    float detectPeriod(const float* window, int numSamples) noexcept override;
+
+private:
+    float cutoff; //fraction of the highest key maximum the chosen peak has to reach
+    int minLag = 0;
+    int maxLag = 0;
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> spectrum;
+    std::vector<float> nsdf; //normalized square difference, indexed by lag
+};
@@ -20,35 +20,55 @@ void knobLook::drawRotarySlider(juce::Graphics& g,
     //get bounds for each knob
     auto bounds = juce::Rectangle<float>(x, y, width, height);
 
-    //color the knob based on what color was passed to it
-    g.setColour(this->colour);
-    g.fillEllipse(bounds);
-
-    //color the knob edge
-    g.setColour(KNOB_EDGE_COLOR);
-    g.drawEllipse(bounds, 1.0);
+    //the face only changes with the knob's size or the display's scale, draw it once and blit it from then on
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (width != faceWidth || height != faceHeight || scale != faceScale) {
+        updateFace(width, height, scale);
+    }
+    g.drawImage(face, bounds);
 
     //draw a line on the knob that points to where it is in the rotation
     auto center = bounds.getCentre();
-    juce::Path dialPath;
     juce::Rectangle<float> dialPointer;
     dialPointer.setLeft(center.getX() - 2);
     dialPointer.setRight(center.getX() + 2);
     dialPointer.setTop(bounds.getY());
     dialPointer.setBottom(center.getY());
-    dialPath.addRectangle(dialPointer);
 
     jassert(rotaryStartAngle < rotaryEndAngle); //make sure the start is before the end, else bad
 
     auto knobAngRad = juce::jmap<float>(sliderPosProportional, 0.0, 1.0, rotaryStartAngle, rotaryEndAngle);
 
-    //apply transform to rotate the dial pointer based on the angle
-    dialPath.applyTransform(juce::AffineTransform().rotated(knobAngRad, center.getX(), center.getY()));
-    g.fillPath(dialPath);
+    //rotate the context rather than building a path, so the pointer costs one filled rectangle
+    juce::Graphics::ScopedSaveState rotatedState(g);
+    g.addTransform(juce::AffineTransform::rotation(knobAngRad, center.getX(), center.getY()));
+    g.setColour(KNOB_EDGE_COLOR);
+    g.fillRect(dialPointer);
+}
+
+void knobLook::updateFace(int width, int height, float scale) {
+    faceWidth = width;
+    faceHeight = height;
+    faceScale = scale;
+    //one image pixel per physical pixel so the cached face is as sharp as drawing it live
+    face = juce::Image(juce::Image::ARGB, juce::jmax(1, juce::roundToInt(width * scale)), juce::jmax(1, juce::roundToInt(height * scale)), true);
+    juce::Graphics faceGraphics(face);
+    faceGraphics.addTransform(juce::AffineTransform::scale(scale));
+    auto bounds = juce::Rectangle<float>(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height));
+
+    //color the knob based on what color was passed to it
+    faceGraphics.setColour(this->colour);
+    faceGraphics.fillEllipse(bounds);
+
+    //color the knob edge
+    faceGraphics.setColour(KNOB_EDGE_COLOR);
+    faceGraphics.drawEllipse(bounds, 1.0);
 }
 //==============================================================================
 
 void paramKnob::paint(juce::Graphics& g) {
+    //we're opaque, so the editor's background behind the knob is ours to fill
+    g.fillAll(findColour(juce::ResizableWindow::backgroundColourId));
 
     //define the start and end angles of the rotary (0 degrees defined as 12 noon)
     auto startAng = juce::degreesToRadians(180.0 + 45.0);
@@ -101,12 +121,13 @@ Harmonicator9000AudioProcessorEditor::Harmonicator9000AudioProcessorEditor (Harm
     evenSynthVolAttatch(audioProcessor.apvts, "evenSynth", evenSynthVol),
     oddSynthVolAttatch(audioProcessor.apvts, "oddSynth", oddSynthVol),
     evenSynthLPAttatch(audioProcessor.apvts, "evenLowPass", evenSynthLP),
-    oddSynthLPAttatch(audioProcessor.apvts, "oddLowPass", oddSynthLP)
+    oddSynthLPAttatch(audioProcessor.apvts, "oddLowPass", oddSynthLP),
+    analyzer(p)
 
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (800, 200);
+    setSize (800, 200 + ANALYZER_HEIGHT + METRICS_ROW_HEIGHT);
     freqLabel.setText("Frequency: 0.0 Hz", juce::dontSendNotification);
     freqLabel.setFont(juce::Font(TEXT_HEIGHT_KNOB_LABELS));
     freqLabel.setJustificationType(juce::Justification::centred);
@@ -116,9 +137,16 @@ Harmonicator9000AudioProcessorEditor::Harmonicator9000AudioProcessorEditor (Harm
     knobLabels.setFont(juce::Font(TEXT_HEIGHT_KNOB_LABELS));
     knobLabels.setJustificationType(juce::Justification::centred);
 
+    metricsLabel.setFont(juce::Font(TEXT_HEIGHT_VALUE_LABELS));
+    metricsLabel.setJustificationType(juce::Justification::centredLeft);
+    dumpMetricsButton.onClick = [this] { dumpMetrics(); };
+
     //make all of the knobs and labels visible on the GUI
     addAndMakeVisible(knobLabels);
     addAndMakeVisible(freqLabel);
+    addAndMakeVisible(metricsLabel);
+    addAndMakeVisible(dumpMetricsButton);
+    addAndMakeVisible(analyzer);
     addAndMakeVisible(fundamentalVol);
     addAndMakeVisible(evenHarmVol);
     addAndMakeVisible(oddHarmVol);
@@ -149,6 +177,10 @@ void Harmonicator9000AudioProcessorEditor::resized()
     //use the built in bounds component to set where all of the knobs will be located(and their size)
     //note that each time a remove is cakled, the space gets smaller, so to do 1/3 1/3 1/3 its 0.33 0.5 1.0
     auto knobBounds = getLocalBounds();
+    auto metricsRow = knobBounds.removeFromBottom(METRICS_ROW_HEIGHT);
+    dumpMetricsButton.setBounds(metricsRow.removeFromRight(90).reduced(2));
+    metricsLabel.setBounds(metricsRow);
+    analyzer.setBounds(knobBounds.removeFromBottom(ANALYZER_HEIGHT));
     knobLabels.setBounds(knobBounds.removeFromTop(knobBounds.getHeight() * 0.1));
     auto oddHarmonicSector = knobBounds.removeFromLeft(knobBounds.getWidth() * 0.4); //left 40% of the area
     auto fundamentalSector = knobBounds.removeFromLeft(knobBounds.getWidth() * 0.33); //middle 20% of the area
@@ -168,6 +200,35 @@ void Harmonicator9000AudioProcessorEditor::resized()
 }
 
 void Harmonicator9000AudioProcessorEditor::timerCallback() {
-    freqLabel.setText(std::to_string(Harmonicator9000AudioProcessor::fundamentalFreq) + " Hz", juce::dontSendNotification);
-    //juce::truncatePositiveToUnsignedInt(Harmonicator9000AudioProcessor::fundamentalFreq)
+    //only touch the label when the number it shows changes, otherwise a steady note costs nothing to display
+    const float freq = std::round(audioProcessor.getFundamentalFreq() * 10.0f) / 10.0f;
+    if (freq != shownFreq) {
+        shownFreq = freq;
+        freqLabel.setText(juce::String(freq, 1) + " Hz", juce::dontSendNotification);
+    }
+
+    //leave the result of a dump up for a few seconds before going back to the numbers
+    if (dumpMessageTicks > 0) {
+        dumpMessageTicks--;
+        return;
+    }
+    auto metrics = audioProcessor.getMetrics().getSnapshot();
+    const double gateSeconds = metrics.gateOpenSeconds + metrics.gateClosedSeconds;
+    metricsLabel.setText("CPU " + juce::String(metrics.lastCpuLoad * 100.0, 1) + "% (mean " + juce::String(metrics.meanCpuLoad * 100.0, 1)
+        + "%, peak " + juce::String(metrics.peakCpuLoad * 100.0, 1) + "%)   block " + juce::String(metrics.meanBlockMicros, 0)
+        + " us (max " + juce::String(metrics.maxBlockMicros, 0) + ")   pitch " + juce::String(static_cast<juce::int64>(metrics.pitchRuns))
+        + " runs, " + juce::String(metrics.meanPitchRunMicros, 0) + " us, " + juce::String(metrics.meanPitchLatencyMs, 1) + " ms late   "
+        + juce::String(static_cast<juce::int64>(metrics.coefficientUpdates)) + " filter updates   gate open "
+        + juce::String(gateSeconds > 0.0 ? 100.0 * metrics.gateOpenSeconds / gateSeconds : 0.0, 0) + "%",
+        juce::dontSendNotification);
+}
+
+void Harmonicator9000AudioProcessorEditor::dumpMetrics() {
+    auto file = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+        .getChildFile("Harmonicator9000").getChildFile("metrics.csv");
+    file.getParentDirectory().createDirectory();
+    const bool saved = audioProcessor.getMetrics().appendToCsv(file);
+    metricsLabel.setText(saved ? "Metrics appended to " + file.getFullPathName() : "Couldn't write " + file.getFullPathName(),
+        juce::dontSendNotification);
+    dumpMessageTicks = METRICS_DUMP_MESSAGE_TICKS;
 }
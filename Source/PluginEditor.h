@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "SpectrumAnalyzer.h"
 
 #define TEXT_HEIGHT_VALUE_LABELS 14.0
 #define TEXT_HEIGHT_KNOB_LABELS 16.0
@@ -23,6 +24,9 @@
 #define KNOB_EDGE_COLOR juce::Colour(255, 255, 255)
 #define TEXT_COLOR juce::Colour(255, 255, 255)
 #define BACKGROUND_COLOR juce::Colour(30, 30, 30)
+#define METRICS_ROW_HEIGHT 22 //the performance line along the bottom
+#define ANALYZER_HEIGHT 160 //the spectrum between the knobs and the performance line
+#define METRICS_DUMP_MESSAGE_TICKS 30 //timer ticks the "saved to" message stays up (3 s at 10 Hz)
 
 struct knobLook : juce::LookAndFeel_V4 {
     knobLook(juce::Colour knobColour) : colour(knobColour) {}
@@ -35,7 +39,14 @@ struct knobLook : juce::LookAndFeel_V4 {
         juce::Slider&) override;
 
     private:
+        //draw the knob face (fill and edge) into the cache, only when the size or pixel scale has changed
+        void updateFace(int width, int height, float scale);
+
         juce::Colour colour;
+        juce::Image face; //the knob without its pointer, at faceScale physical pixels per point
+        int faceWidth = 0;
+        int faceHeight = 0;
+        float faceScale = 0.0f;
 
 };
 
@@ -49,6 +60,8 @@ struct paramKnob : juce::Slider {
         upperBoundLabel(upperBoundLabel)
     {
         setLookAndFeel(&look);
+        //paint fills the whole knob, so moving it never repaints the editor behind
+        setOpaque(true);
     }
 
     //destructor
@@ -87,6 +100,12 @@ private:
     void timerCallback() override;
     juce::Label freqLabel;
     juce::Label knobLabels;
+    float shownFreq = -1.0f; //the frequency freqLabel is showing (to one decimal), -1 before the first tick
+    juce::Label metricsLabel;
+    juce::TextButton dumpMetricsButton{ "Dump CSV" };
+    int dumpMessageTicks = 0; //counts down while the last dump's result is showing instead of the metrics
+    //append the current metrics to a CSV in the user's documents
+    void dumpMetrics();
     paramKnob fundamentalVol;
     paramKnob evenHarmVol;
     paramKnob oddHarmVol;
@@ -108,6 +127,8 @@ private:
     knobAttatch evenSynthLPAttatch;
     knobAttatch oddSynthLPAttatch;
 
+    SpectrumAnalyzer analyzer;
+
 
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Harmonicator9000AudioProcessorEditor)
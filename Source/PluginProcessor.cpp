@@ -25,10 +25,38 @@ Harmonicator9000AudioProcessor::Harmonicator9000AudioProcessor()
 
 #endif
 {
+    //lane 0 is always there, the GUI reads its pitch before we are ever prepared
+    lanes[0] = std::make_unique<AnalysisLane>(0);
+
+    //find every parameter's atomic once, the ids match createParameterLayout
+    params.oddLowPass = apvts.getRawParameterValue("oddLowPass");
+    params.oddSynth = apvts.getRawParameterValue("oddSynth");
+    params.oddHarmonics = apvts.getRawParameterValue("oddHarmonics");
+    params.fundamental = apvts.getRawParameterValue("fundamental");
+    params.evenHarmonics = apvts.getRawParameterValue("evenHarmonics");
+    params.evenSynth = apvts.getRawParameterValue("evenSynth");
+    params.evenLowPass = apvts.getRawParameterValue("evenLowPass");
+    params.pitchDetector = apvts.getRawParameterValue("pitchDetector");
+    params.analysisHop = apvts.getRawParameterValue("analysisHop");
+    params.oscillatorMode = apvts.getRawParameterValue("oscillatorMode");
+    params.lookahead = apvts.getRawParameterValue("lookahead");
+    params.filterEngine = apvts.getRawParameterValue("filterEngine");
+    params.pitchTracking = apvts.getRawParameterValue("pitchTracking");
+    params.synthQuality = apvts.getRawParameterValue("synthQuality");
+    params.harmonicCount = apvts.getRawParameterValue("harmonicCount");
+    params.pitchSource = apvts.getRawParameterValue("pitchSource");
+    params.midiOut = apvts.getRawParameterValue("midiOut");
+    params.gateThreshold = apvts.getRawParameterValue("gateThreshold");
+    params.gateHysteresis = apvts.getRawParameterValue("gateHysteresis");
+    params.gateAttack = apvts.getRawParameterValue("gateAttack");
+    params.gateRelease = apvts.getRawParameterValue("gateRelease");
+    params.gateDetector = apvts.getRawParameterValue("gateDetector");
 }
 
 Harmonicator9000AudioProcessor::~Harmonicator9000AudioProcessor()
 {
+    cancelPendingUpdate();
+    stopAnalysis();
 }
 
 //==============================================================================
@@ -66,7 +94,11 @@ bool Harmonicator9000AudioProcessor::isMidiEffect() const
 
 double Harmonicator9000AudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    //the longest ring out is the fundamental band on the lowest note with its knob all the way up. A boost pulls
+    //an RBJ peak's poles in by A, so they decay by one neper every Q * A / (pi f) seconds and 60 dB is ln(1000) of those.
+    //A = 10^(dB / 40) at the full boost, about 2.37 for 15 dB, which puts Q = 10 at 40 Hz at about 1.3 s
+    const double maxA = std::pow(10.0, BAND_GAIN_RANGE_DB / 40.0);
+    return std::log(1000.0) * FILTER_QUALITY * maxA / (juce::MathConstants<double>::pi * MINIMUM_FREQ);
 }
 
 int Harmonicator9000AudioProcessor::getNumPrograms()
@@ -94,237 +126,359 @@ void Harmonicator9000AudioProcessor::changeProgramName (int index, const juce::S
 }
 
 //==============================================================================
-void Harmonicator9000AudioProcessor::addToCorr(float sample) noexcept{
-    //check if the index is at the end of the queue, if so start a new fft process
-    if (corrCounter == LARGE_PITCH_ARRAY_SIZE) {
-        if (!processingAvg) {
-            std::copy(largePitchArray.begin(), largePitchArray.end(), avgVolArray.begin());
-            processingAvg = true;
-            //spawn a thread to do our dirty work
-            std::thread avgThread(&Harmonicator9000AudioProcessor::updateAvg, this);
-            avgThread.detach(); //let the thread go frolic on its own
-        }
-        if (!nextCorrBlockReady) {
-            //the correlation calcs have completed, we can start a new one
-            //add the first 256 samples in largePitchArray to the small array
-            std::copy(largePitchArray.begin(), largePitchArray.begin() + SMALL_PITCH_ARRAY_SIZE, smallPitchArray.begin());
-            nextCorrBlockReady = true;
-            //spawn a thread to go calculate the new fundamental frequency (currently producing like 80 threads)
-            std::thread corrThread(&Harmonicator9000AudioProcessor::getFundamentalFrequency, this);
-            corrThread.detach(); //let the thread go frolic on its own
-
-        }
-        corrCounter = 0;
-    }
-    //add sample and advance the counter
-    largePitchArray[corrCounter] = sample;
-    corrCounter++;
+//analysis workers, everything in here runs off of the audio thread
+
+Harmonicator9000AudioProcessor::AnalysisLane::AnalysisLane(int index) : laneIndex(index) {
+    //the original AMDF keeps its hand tuned reference size and threshold
+    pitchDetectors[static_cast<size_t>(PitchDetectorMode::amdf)] =
+        std::make_unique<AmdfPitchDetector>(SMALL_PITCH_ARRAY_SIZE, 8, static_cast<float>(PITCH_DETECTION_THRESH));
+    pitchDetectors[static_cast<size_t>(PitchDetectorMode::yin)] = PitchDetector::create(PitchDetectorMode::yin);
+    pitchDetectors[static_cast<size_t>(PitchDetectorMode::mcLeod)] = PitchDetector::create(PitchDetectorMode::mcLeod);
+
+    //a harmonic cascade of every size
+    for (int count = 0; count < numHarmonicCounts; ++count) {
+        harmonicCascades[count] = HarmonicCascade::create(harmonicsPerSide[count]);
+    }
+
+    //the synth oversamplers are made up front too (in powers of two), switching quality just resets one
+    using Oversampler = juce::dsp::Oversampling<float>;
+    synthOversamplers[ecoSynth] = std::make_unique<Oversampler>(1, 1, Oversampler::filterHalfBandPolyphaseIIR, false, true);
+    synthOversamplers[normalSynth] = std::make_unique<Oversampler>(1, 2, Oversampler::filterHalfBandPolyphaseIIR, true, true);
+    synthOversamplers[highSynth] = std::make_unique<Oversampler>(1, 3, Oversampler::filterHalfBandFIREquiripple, true, true);
 }
-//==============================================================================
-//wave generators
 
-void Harmonicator9000AudioProcessor::getNextSquare() noexcept {
-    int i = 0;
-    while (i < squareOutBuff.size()) {
-        //update what sample we are at
-        squareNumSamples++;
-        if (squareNumSamples >= cycleTimeSamples) {
-            squareNumSamples = 0;
+void Harmonicator9000AudioProcessor::AnalysisWorker::run() {
+    while (!threadShouldExit()) {
+        //sleep until the audio thread hands us a block, time out now and then so we notice a stop request
+        if (wake.try_acquire_for(std::chrono::milliseconds(50))) {
+            //say we're in before looking at the hold, the render thread sets the hold and then waits for us to be out
+            busy.store(true);
+            if (!processor.workersHeld.load()) {
+                processor.runWorkerPass(workerIndex);
+            }
+            busy.store(false);
         }
-        //if we are in the first half of the cycle, return full
-        if (squareNumSamples < (cycleTimeSamples / 2)) {
-            squareOutBuff[i] = juce::Decibels::decibelsToGain(evenSynthVol) * avgVol;
+    }
+}
+
+void Harmonicator9000AudioProcessor::startAnalysis() {
+    stopAnalysis();
+    for (int lane = 0; lane < numLanes; ++lane) {
+        lanes[lane]->analysisFifo.reset();
+    }
+    for (int worker = 0; worker < numWorkers; ++worker) {
+        while (analysisWorkers[worker]->wake.try_acquire()) {} //throw away any stale wake ups from the last run
+        analysisWorkers[worker]->startThread();
+    }
+}
+
+void Harmonicator9000AudioProcessor::stopAnalysis() {
+    //ask them all first so they wind down together
+    for (auto& worker : analysisWorkers) {
+        if (worker != nullptr) {
+            worker->signalThreadShouldExit();
+            worker->wake.release(); //kick it out of its wait so we don't sit on the timeout
         }
-        else {
-            squareOutBuff[i] = -(juce::Decibels::decibelsToGain(evenSynthVol) * avgVol);
+    }
+    for (auto& worker : analysisWorkers) {
+        if (worker != nullptr) {
+            worker->stopThread(1000);
         }
-        i++;
     }
 }
 
-void Harmonicator9000AudioProcessor::getNextSaw() noexcept {
-    //update, except the count goes in reverse to be able to build the wave properly
-    int i = 0;
-    while (i < sawOutBuff.size()) {
-        sawNumSamples--;
-        if (sawNumSamples <= 0) {
-            sawNumSamples = cycleTimeSamples;
+int Harmonicator9000AudioProcessor::pushToAnalysis(AnalysisLane& lane, const float* samples, int numSamples) noexcept {
+    int start1, size1, start2, size2;
+    //if the worker has fallen behind we just drop whatever doesn't fit, the audio thread never waits on it
+    lane.analysisFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    for (int i = 0; i < size1; ++i) {
+        //process at higher gain for less float resolution error in pich calculation
+        lane.analysisFifoData[start1 + i] = samples[i] * 8;
+    }
+    for (int i = 0; i < size2; ++i) {
+        lane.analysisFifoData[start2 + i] = samples[size1 + i] * 8;
+    }
+    lane.analysisFifo.finishedWrite(size1 + size2);
+    metrics.recordHandoff(juce::Time::getHighResolutionTicks());
+    return size1 + size2;
+}
+
+void Harmonicator9000AudioProcessor::feedAnalysis(AnalysisLane& lane, const float* samples, int numSamples) {
+    if (!isNonRealtime()) {
+        if (numSamples > 0) {
+            pushToAnalysis(lane, samples, numSamples);
         }
-        //return the ratio of the num samples / cycle time samples to get the saw pattern * vol
-        sawOutBuff[i] =  (static_cast<float>(sawNumSamples) / static_cast<float>(cycleTimeSamples)) * juce::Decibels::decibelsToGain(oddSynthVol) * avgVol;
-        i++;
+        return;
     }
+    //rendering offline there is no deadline to keep, so run the analysis right here on the render thread,
+    //that way nothing gets dropped and every render of the same file comes out identical
+    runOfflineAnalysis(lane, samples, numSamples);
+}
 
+void Harmonicator9000AudioProcessor::switchAnalysisPath(bool offline) noexcept {
+    if (offline == analysingOffline) {
+        return;
+    }
+    analysingOffline = offline;
+    if (offline) {
+        //a worker woken by the last realtime block can still be in its lanes, hold them all off and wait it out.
+        //There is no deadline offline, so waiting here is fine
+        workersHeld.store(true);
+        for (int worker = 0; worker < numWorkers; ++worker) {
+            while (analysisWorkers[worker]->busy.load()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    //the ring and countdown were left by the other path and its window size, start every lane over for this one
+    for (int lane = 0; lane < numLanes; ++lane) {
+        resetLaneAnalysis(*lanes[lane], offline ? offlineWindowSize : analysisWindowSize);
+    }
+    if (!offline) {
+        workersHeld.store(false);
+    }
 }
 
-//==============================================================================
-void Harmonicator9000AudioProcessor::getFundamentalFrequency() noexcept{
-    //while we're here, this is a great time to see im the user updated any knobs
-    getUserDefinedSettings(apvts);
-    //perform the autocorrelation, find the first strongest peak, do math to determine frequency
-    
-    //do not update the pitch below a certian volume
-    int minIndex = 0;
-    float minVal = 999999999999; //some absurdly large number
-    //keep track of how far we've shifted the larger array
-    int indexOffset = 8; //start slightly offset because the first samples will obviously line up.
-    std::array<float, 3> lastThree = { 0, 0, 0};
-    
-    while (indexOffset < LARGE_PITCH_ARRAY_SIZE - SMALL_PITCH_ARRAY_SIZE) {
+void Harmonicator9000AudioProcessor::resetLaneAnalysis(AnalysisLane& lane, int windowSize) noexcept {
+    lane.analysisFifo.reset();
+    lane.analysisDecimator.reset();
+    lane.analysisRing.fill(0.0f);
+    lane.ringWritePosition = 0;
+    lane.samplesUntilAnalysis = windowSize;
+    lane.slidingHop = 0;
+    lane.slidingDetector = -1;
+}
 
-        float accumDiff = 0;
-        int i = 0;
+void Harmonicator9000AudioProcessor::runOfflineAnalysis(AnalysisLane& lane, const float* samples, int numSamples) {
+    //the threads and detectors only get made once something actually renders offline
+    if (!offlineAnalysis.isPrepared()) {
+        offlineAnalysis.prepare(sampleRate / analysisFactor, offlineWindowSize, MINIMUM_FREQ, MAX_FREQ);
+    }
+    getUserDefinedSettings(lane);
 
-        while (i < SMALL_PITCH_ARRAY_SIZE) {
-            //go through each sample of the small array and subtract it from the big array at it's offset index from i
-            accumDiff += abs(smallPitchArray[i] - largePitchArray[i + indexOffset]);
-            i++;
+    //the same decimated ring as the live path, but a longer window every few samples
+    const int hop = juce::jmax(1, OFFLINE_ANALYSIS_HOP / analysisFactor);
+    float decimated;
+    for (int i = 0; i < numSamples; ++i) {
+        //process at higher gain for less float resolution error in pich calculation
+        if (!lane.analysisDecimator.pushSample(samples[i] * 8, decimated)) {
+            continue;
         }
-        lastThree[2] = lastThree[1];
-        lastThree[1] = lastThree[0];
-        lastThree[0] = accumDiff;
-        //see if it is above the threshold and also is a peak
-        if ((lastThree[1] < minVal - PITCH_DETECTION_THRESH) &&
-            (lastThree[2] > lastThree[1]) && (lastThree[0] > lastThree[1])) {
-            minIndex = indexOffset - 1;
-            minVal = lastThree[1];
+        lane.analysisRing[lane.ringWritePosition & (ANALYSIS_RING_SIZE - 1)] = decimated;
+        lane.ringWritePosition++;
+        if (--lane.samplesUntilAnalysis > 0) {
+            continue;
         }
-        indexOffset++;
+        lane.samplesUntilAnalysis = hop;
+        float* window = offlineAnalysis.addWindow();
+        const uint32_t start = lane.ringWritePosition - static_cast<uint32_t>(offlineWindowSize);
+        for (int n = 0; n < offlineWindowSize; ++n) {
+            window[n] = lane.analysisRing[(start + n) & (ANALYSIS_RING_SIZE - 1)];
+        }
+        if (offlineAnalysis.isFull()) {
+            applyOfflineBatch(lane);
+        }
+    }
+    //whatever is left over is this block's too, the render waits for all of it
+    applyOfflineBatch(lane);
+    lane.slidingHop = 0; //the live detectors' sliding sums are from before the render, start them over if we go live again
+    updateFiltersIfChanged(lane);
+}
+
+void Harmonicator9000AudioProcessor::applyOfflineBatch(AnalysisLane& lane) {
+    offlineAnalysis.analyse(static_cast<PitchDetectorMode>(juce::jlimit(0, static_cast<int>(PitchDetectorMode::numModes) - 1, lane.detectorMode)));
+    const auto batchEnd = juce::Time::getHighResolutionTicks();
+    //the stability checks carry from one window to the next, so they go through the results in order
+    for (int window = 0; window < offlineAnalysis.getNumWindows(); ++window) {
+        if (lane.laneIndex == 0) {
+            metrics.recordPitchRun(offlineAnalysis.getRunTicks(window), batchEnd);
+        }
+        const float period = offlineAnalysis.getPeriod(window);
+        if (period > 0.0f) {
+            acceptPeriod(lane, period * static_cast<float>(analysisFactor));
+        }
+    }
+    offlineAnalysis.clear();
+}
+
+void Harmonicator9000AudioProcessor::runWorkerPass(int workerIndex) noexcept {
+    if (workerIndex == 0) {
+        passOnLatency();
+    }
+    //MIDI is setting the pitch, the only reason to be woken is to pass on a latency change
+    if (static_cast<int>(params.pitchSource->load()) == midiPitch) {
+        return;
+    }
+    for (int lane = workerIndex; lane < numLanes; lane += numWorkers) {
+        runAnalysis(*lanes[lane]);
     }
+}
+
+void Harmonicator9000AudioProcessor::runAnalysis(AnalysisLane& lane) noexcept {
+    //while we're here, this is a great time to see if the user updated any knobs
+    getUserDefinedSettings(lane);
+
+    //decimate everything that is ready into the pitch ring, this kicks off a pitch calc every hop
+    int start1, size1, start2, size2;
+    lane.analysisFifo.prepareToRead(lane.analysisFifo.getNumReady(), start1, size1, start2, size2);
+    float decimated;
+    for (int i = 0; i < size1; ++i) {
+        if (lane.analysisDecimator.pushSample(lane.analysisFifoData[start1 + i], decimated)) {
+            addToCorr(lane, decimated);
+        }
+    }
+    for (int i = 0; i < size2; ++i) {
+        if (lane.analysisDecimator.pushSample(lane.analysisFifoData[start2 + i], decimated)) {
+            addToCorr(lane, decimated);
+        }
+    }
+    lane.analysisFifo.finishedRead(size1 + size2);
+    updateFiltersIfChanged(lane);
+}
+
+void Harmonicator9000AudioProcessor::updateFiltersIfChanged(AnalysisLane& lane) noexcept {
+    //if things have changed, cook up a new set of coefficients for the audio thread (unless it is tuning its own)
+    if (lane.workerBuildsCoefficients && !((lane.lastFundVol == lane.fundamentalVol) && (lane.lastFreq == lane.fundamentalFreq.load()) &&
+        (lane.lastOddVol == lane.oddHarmVol) && (lane.lastEvenVol == lane.evenHarmVol) && (lane.lastHarmonicCount == lane.harmonicCount))) {
+        updateFilters(lane);
+    }
+}
+
+void Harmonicator9000AudioProcessor::passOnLatency() noexcept {
+    //the audio thread moved the lookahead, tell the host (from the message thread) about the new latency
+    if (reportedLatency.load() != notifiedLatency) {
+        notifiedLatency = reportedLatency.load();
+        triggerAsyncUpdate();
+    }
+}
+
+void Harmonicator9000AudioProcessor::addToCorr(AnalysisLane& lane, float sample) noexcept{
+    lane.analysisRing[lane.ringWritePosition & (ANALYSIS_RING_SIZE - 1)] = sample;
+    lane.ringWritePosition++;
+    if (--lane.samplesUntilAnalysis > 0) {
+        return;
+    }
+    lane.samplesUntilAnalysis = lane.analysisHop;
+
+    //unwrap the newest window, with the samples that just slid out of it in front, into one straight array
+    const int numToUnwrap = MAX_ANALYSIS_HOP + analysisWindowSize;
+    const uint32_t start = lane.ringWritePosition - static_cast<uint32_t>(numToUnwrap);
+    for (int i = 0; i < numToUnwrap; ++i) {
+        lane.largePitchArray[i] = lane.analysisRing[(start + i) & (ANALYSIS_RING_SIZE - 1)];
+    }
+    //a new hop or detector means the running sums belong to some other window
+    if (lane.analysisHop != lane.slidingHop || lane.detectorMode != lane.slidingDetector) {
+        for (auto& detector : lane.pitchDetectors) {
+            detector->resetSliding();
+        }
+        lane.slidingHop = lane.analysisHop;
+        lane.slidingDetector = lane.detectorMode;
+    }
+    getFundamentalFrequency(lane);
+}
+//==============================================================================
+void Harmonicator9000AudioProcessor::getFundamentalFrequency(AnalysisLane& lane) noexcept{
+    //ask whichever detector the user picked for the period of this window (in samples, can be fractional)
+    auto& detector = *lane.pitchDetectors[juce::jlimit(0, static_cast<int>(PitchDetectorMode::numModes) - 1, lane.detectorMode)];
+    const float* window = lane.largePitchArray.data() + MAX_ANALYSIS_HOP;
+    //overlapping windows let the detector carry its sums over from the last hop where it can
+    const auto detectStart = juce::Time::getHighResolutionTicks();
+    float period = lane.analysisHop < analysisWindowSize && lane.analysisHop <= MAX_ANALYSIS_HOP
+        ? detector.detectPeriodSliding(window, analysisWindowSize, lane.analysisHop)
+        : detector.detectPeriod(window, analysisWindowSize);
+    if (lane.laneIndex == 0) {
+        const auto detectEnd = juce::Time::getHighResolutionTicks();
+        metrics.recordPitchRun(detectEnd - detectStart, detectEnd);
+    }
+    if (period <= 0.0f) {
+        return; //nothing clear enough to call a pitch, keep the last one
+    }
+    //back to host rate samples, everything after works at the host rate
+    acceptPeriod(lane, period * static_cast<float>(analysisFactor));
+}
+
+void Harmonicator9000AudioProcessor::acceptPeriod(AnalysisLane& lane, float period) noexcept {
+    int minIndex = juce::roundToInt(period);
+
     //if the frequency change is significant, update it
-    if ((minIndex > cycleTimeSamples + CRITICAL_SAMPLE_SHIFT) ||
-        (minIndex < cycleTimeSamples - CRITICAL_SAMPLE_SHIFT) && 
-        (avgVol > CRITICAL_VOLUME_THRESH)) {
-        //map this to an analog frequency based on sample rate. (sample rate / minIndex)
-        float fundamentalFreqNew = sampleRate / minIndex;
+    int currentCycle = lane.cycleTimeSamples.load();
+    if ((minIndex > currentCycle + CRITICAL_SAMPLE_SHIFT) ||
+        (minIndex < currentCycle - CRITICAL_SAMPLE_SHIFT) && 
+        lane.gateOpen.load(std::memory_order_relaxed)) {
+        //map this to an analog frequency based on sample rate. (sample rate / period)
+        float fundamentalFreqNew = sampleRate / period;
         //basically make sure we are inside the bounds for a valid pitch shift operation,
         //do a lot of checks to try to keep the frequency detection stable from glitches
-        if ((fundamentalFreqNew * 2 > fundamentalFreq + 1.5 || fundamentalFreqNew * 2 < fundamentalFreq - 1.5)
+        if ((fundamentalFreqNew * 2 > lane.fundamentalFreq + 1.5 || fundamentalFreqNew * 2 < lane.fundamentalFreq - 1.5)
             && ((fundamentalFreqNew <= MAX_FREQ) && (fundamentalFreqNew >= MINIMUM_FREQ))){
-            if ((fundamentalFreqNew <= lastFreqPitch + CRITICAL_SAMPLE_SHIFT) &&
-                (fundamentalFreqNew >= lastFreqPitch - CRITICAL_SAMPLE_SHIFT)) {
-                cycleTimeSamples = minIndex; //update for the wave generators
-                fundamentalFreq = fundamentalFreqNew;
+            if ((fundamentalFreqNew <= lane.lastFreqPitch + CRITICAL_SAMPLE_SHIFT) &&
+                (fundamentalFreqNew >= lane.lastFreqPitch - CRITICAL_SAMPLE_SHIFT)) {
+                lane.cycleTimeSamples = minIndex; //the period we compare the next window against
+                lane.fundamentalFreq = fundamentalFreqNew;
             }
-            lastFreqPitch = fundamentalFreqNew;
+            lane.lastFreqPitch = fundamentalFreqNew;
         }
     }
-    nextCorrBlockReady = false; //new thread can be spawned now, we're leaving this one
-
 }
 //==============================================================================
-void Harmonicator9000AudioProcessor::updateAvg() noexcept {
-    //use the avgVolArray to update avgVol.
-    int i = 0;
-    float tmpAvg = 0.0;
-    while (i < avgVolArray.size()) {
-        tmpAvg += abs(avgVolArray[i]);
-        i++;
+void Harmonicator9000AudioProcessor::updateFilters(AnalysisLane& lane) noexcept {
+    float fundamentalCopy = lane.fundamentalFreq; //make a copy so it remains consistent throughout the calc
+    float oddVolCopy = lane.oddHarmVol;
+    float evenVolCopy = lane.evenHarmVol;
+    float fundVolCopy = lane.fundamentalVol;
+    //reset these flags
+    lane.lastFreq = fundamentalCopy;
+    lane.lastEvenVol = evenVolCopy;
+    lane.lastOddVol = oddVolCopy;
+    lane.lastFundVol = fundVolCopy;
+    lane.lastHarmonicCount = lane.harmonicCount;
+
+    const bool changed = buildCoefficients(fundamentalCopy, fundVolCopy, oddVolCopy, evenVolCopy, lane.harmonicCount,
+        lane.currentCoefs, lane.bandFreqIndex, lane.bandGainIndex);
+
+    //hand the full set to the audio thread, the back buffer may be a couple of publishes old so it all gets copied
+    if (changed) {
+        lane.coefficientBuffer.getWriteBuffer() = lane.currentCoefs;
+        lane.coefficientBuffer.publish();
+        if (lane.laneIndex == 0) {
+            metrics.recordCoefficientUpdate();
+        }
     }
-    avgVol = tmpAvg / LARGE_PITCH_ARRAY_SIZE;
-    processingAvg = false;
+}
 
+bool Harmonicator9000AudioProcessor::buildCoefficients(float fundamental, float fundVol, float oddVol, float evenVol, int count,
+    harmonicCoefficients& coefs, std::array<int, MAX_BAND_HARMONIC>& freqIndexes, std::array<int, MAX_BAND_HARMONIC>& gainIndexes) const noexcept {
+    const int harmonics = harmonicsPerSide[juce::jlimit(0, numHarmonicCounts - 1, count)];
+    //quantize everything to the table, bands whose indexes didn't move keep what they have
+    const int freqIndex = peakTable.getFreqIndex(fundamental);
+    const int fundGain = peakTable.getGainIndex(fundVol);
+    const int oddGain = peakTable.getGainIndex(oddVol);
+    const int evenGain = peakTable.getGainIndex(evenVol);
+
+    bool changed = false;
+    for (int harmonic = 1; harmonic <= MAX_BAND_HARMONIC; ++harmonic) {
+        //harmonics the selected cascade has no band for keep whatever they had, nothing reads them
+        if (!hasHarmonicBand(harmonic, harmonics, harmonics)) {
+            continue;
+        }
+        const int band = harmonic - 1;
+        const int gainIndex = harmonic == 1 ? fundGain : (harmonic % 2 == 1 ? oddGain : evenGain);
+        if (freqIndex == freqIndexes[band] && gainIndex == gainIndexes[band]) {
+            continue;
+        }
+        if (!peakTable.getCoefficients(harmonic, freqIndex, gainIndex, coefs[band].data())) {
+            coefs[band] = allPassCoefs; //past nyquist, nothing to boost or cut up there
+        }
+        freqIndexes[band] = freqIndex;
+        gainIndexes[band] = gainIndex;
+        changed = true;
+    }
+    return changed;
 }
-//==============================================================================
-void Harmonicator9000AudioProcessor::updateFilters() noexcept {
-    //use the booleans to check which filter we need to update then update that one
-    float fundamentalCopy = fundamentalFreq; //make a copy so it remains consistent throughout the thread
-    float oddVolCopy = oddHarmVol;
-    float evenVolCopy = evenHarmVol;
-    float fundVolCopy = fundamentalVol;
-    //reset these flags
-    lastFreq = fundamentalCopy;
-    lastEvenVol = evenVolCopy;
-    lastOddVol = oddVolCopy;
-    lastFundVol = fundVolCopy;
-    //prepare all the coeficients (they will be the same no matter which group is updated)
-    auto genericCoefs = juce::dsp::IIR::Coefficients<float>::makeAllPass(
-        sampleRate,
-        300
-    );
-    fundamentalCoefs = genericCoefs;
-    oddOneCoefs = genericCoefs;
-    oddTwoCoefs = genericCoefs;
-    oddThreeCoefs = genericCoefs;
-    oddFourCoefs = genericCoefs;
-    evenOneCoefs = genericCoefs;
-    evenTwoCoefs = genericCoefs;
-    evenThreeCoefs = genericCoefs;
-    evenFourCoefs = genericCoefs;
-
-    if (fundamentalCopy < sampleRate / 2) {
-        fundamentalCoefs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            sampleRate,
-            fundamentalCopy,
-            FILTER_QUALITY,
-            juce::Decibels::decibelsToGain(fundVolCopy)
-        );
-    }
-    if (fundamentalCopy * 3 < sampleRate / 2) {
-        oddOneCoefs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            sampleRate,
-            fundamentalCopy * 3,
-            FILTER_QUALITY,
-            juce::Decibels::decibelsToGain(oddVolCopy)
-        );
-    }
-    if (fundamentalCopy * 5 < sampleRate / 2) {
-        oddTwoCoefs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            sampleRate,
-            fundamentalCopy * 5,
-            FILTER_QUALITY,
-            juce::Decibels::decibelsToGain(oddVolCopy)
-        );
-    }
-    if (fundamentalCopy * 7 < sampleRate / 2) {
-        oddThreeCoefs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            sampleRate,
-            fundamentalCopy * 7,
-            FILTER_QUALITY,
-            juce::Decibels::decibelsToGain(oddVolCopy)
-        );
-    }
-   /* if (fundamentalCopy * 9 < sampleRate / 2) {
-        oddFourCoefs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            sampleRate,
-            fundamentalCopy * 9,
-            FILTER_QUALITY,
-            juce::Decibels::decibelsToGain(oddVolCopy)
-        );
-    }*/
-    if (fundamentalCopy * 2 < sampleRate / 2) {
-        evenOneCoefs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            sampleRate,
-            fundamentalCopy * 2,
-            FILTER_QUALITY,
-            juce::Decibels::decibelsToGain(evenVolCopy)
-        );
-    }
-    if (fundamentalCopy * 4 < sampleRate / 2) {
-        evenTwoCoefs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            sampleRate,
-            fundamentalCopy * 4,
-            FILTER_QUALITY,
-            juce::Decibels::decibelsToGain(evenVolCopy)
-        );
-    }
-    if (fundamentalCopy * 6 < sampleRate / 2) {
-        evenThreeCoefs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            sampleRate,
-            fundamentalCopy * 6,
-            FILTER_QUALITY,
-            juce::Decibels::decibelsToGain(evenVolCopy)
-        );
-    }
-   /* if (fundamentalCopy * 8 < sampleRate / 2) {
-        evenFourCoefs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            sampleRate,
-            fundamentalCopy * 8,
-            FILTER_QUALITY,
-            juce::Decibels::decibelsToGain(evenVolCopy)
-        );
-    }*/
-    coefficientsRdy = true;
+
+void Harmonicator9000AudioProcessor::applyCoefficients(AnalysisLane& lane, const harmonicCoefficients& newCoefs) noexcept {
+    //just copies into the running cascade's coefficient registers, no allocation
+    lane.harmonicCascades[harmonicCount]->setCoefficients(newCoefs.data());
 }
 
 //==============================================================================
@@ -333,57 +487,175 @@ void Harmonicator9000AudioProcessor::prepareToPlay (double sampleRate, int sampl
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
 
+    //stop the workers while we rebuild everything they touch
+    stopAnalysis();
+
     //update the sample rate
     Harmonicator9000AudioProcessor::sampleRate = sampleRate;
+    metrics.prepare(sampleRate);
 
-    //set the mode of various filters
-    oddLowPass.setMode(juce::dsp::LadderFilterMode::LPF24);
-    evenLowPass.setMode(juce::dsp::LadderFilterMode::LPF24);
+    //a lane for every input channel, spread over as many workers as there are spare cores (the audio thread has one)
+    const int numChannels = juce::jlimit(1, static_cast<int>(MAX_CHANNELS), juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels()));
+    numLanes = juce::jlimit(1, static_cast<int>(MAX_CHANNELS), getTotalNumInputChannels());
+    for (int lane = 0; lane < numLanes; ++lane) {
+        if (lanes[lane] == nullptr) {
+            lanes[lane] = std::make_unique<AnalysisLane>(lane);
+        }
+    }
+    numWorkers = juce::jlimit(1, juce::jmin(numLanes, static_cast<int>(MAX_ANALYSIS_WORKERS)), juce::SystemStats::getNumCpus() - 1);
+    for (int worker = 0; worker < numWorkers; ++worker) {
+        if (analysisWorkers[worker] == nullptr) {
+            analysisWorkers[worker] = std::make_unique<AnalysisWorker>(*this, worker);
+        }
+    }
 
-    //set the synth output buffers to the samplesPerBlock size
-    squareOutBuff.resize(samplesPerBlock);
-    sawOutBuff.resize(samplesPerBlock);
+    //the engine never renders more than a quantum at once, whatever samplesPerBlock says, so every scratch buffer
+    //(and everything the synths prepare) is one quantum long. Every lane renders through them in turn
+    squareOutBuff.resize(PROCESS_QUANTUM);
+    sawOutBuff.resize(PROCESS_QUANTUM * MAX_SYNTH_OVERSAMPLING);
+    analysisMixBuff.resize(PROCESS_QUANTUM);
+    gateGainBuff.resize(PROCESS_QUANTUM);
     //create a spec to use for all of the filters
     juce::dsp::ProcessSpec filtSpec;
     filtSpec.sampleRate = sampleRate;
-    filtSpec.maximumBlockSize = samplesPerBlock;
+    filtSpec.maximumBlockSize = PROCESS_QUANTUM;
     filtSpec.numChannels = 1;
 
-    //prepare all of the filters
-    oddLowPass.prepare(filtSpec);
-    evenLowPass.prepare(filtSpec);
-    fundamentalBandR.prepare(filtSpec);
-    firstOddBandR.prepare(filtSpec);
-    secondOddBandR.prepare(filtSpec);
-    thirdOddBandR.prepare(filtSpec);
-    fourthOddBandR.prepare(filtSpec);
-    firstEvenBandR.prepare(filtSpec);
-    secondEvenBandR.prepare(filtSpec);
-    thirdEvenBandR.prepare(filtSpec);
-    fourthEvenBandR.prepare(filtSpec);
-    fundamentalBandL.prepare(filtSpec);
-    firstOddBandL.prepare(filtSpec);
-    secondOddBandL.prepare(filtSpec);
-    thirdOddBandL.prepare(filtSpec);
-    fourthOddBandL.prepare(filtSpec);
-    firstEvenBandL.prepare(filtSpec);
-    secondEvenBandL.prepare(filtSpec);
-    thirdEvenBandL.prepare(filtSpec);
-    fourthEvenBandL.prepare(filtSpec);
-    
+    //the pitch analysis only needs the bottom few kHz, divide the rate down to around ANALYSIS_TARGET_RATE
+    //and keep the window the same length in time whatever the host rate
+    analysisFactor = juce::jmax(1, static_cast<int>(sampleRate / ANALYSIS_TARGET_RATE));
+    analysisWindowSize = juce::jlimit(16, static_cast<int>(LARGE_PITCH_ARRAY_SIZE), juce::roundToInt(ANALYSIS_WINDOW_SECONDS * sampleRate / analysisFactor));
+    offlineWindowSize = juce::jlimit(16, static_cast<int>(LARGE_PITCH_ARRAY_SIZE), juce::roundToInt(OFFLINE_WINDOW_SECONDS * sampleRate / analysisFactor));
+    offlineAnalysis.release(); //made again at this rate by the next offline render
 
-    //set up filters in a startup state so that the process block will actually work
-    coefficientsRdy = false;
-    //this should update all of the filters to something so things don't break
-    updateFilters();
+    //build the peak coefficient table for this rate, every lane starts every band off as all pass
+    peakTable.prepare(sampleRate, MINIMUM_FREQ, MAX_FREQ, MAX_BAND_HARMONIC, FILTER_QUALITY, BAND_GAIN_RANGE_DB);
+    auto allPass = juce::dsp::IIR::Coefficients<float>::makeAllPass(sampleRate, 300);
+    std::copy(allPass->coefficients.begin(), allPass->coefficients.end(), allPassCoefs.begin());
+
+    midiOutBuff.ensureSize(MIDI_OUT_BUFFER_BYTES);
+    midiThroughBuff.ensureSize(MIDI_OUT_BUFFER_BYTES);
+    //the workers are stopped, so the lanes start on whichever path the host is rendering with
+    analysingOffline = isNonRealtime();
+    workersHeld = analysingOffline;
+    //every lane gets banks wide enough for the whole bus, so shared tracking can run lane 0 over all of it
+    for (int lane = 0; lane < numLanes; ++lane) {
+        prepareLane(*lanes[lane], filtSpec, numChannels);
+    }
 
-    getUserDefinedSettings(apvts);
+    //every lane's oversamplers are the same, the synths come out of each quality this far behind
+    synthLatencies[hostRateSynth] = 0;
+    for (int quality = ecoSynth; quality < numSynthQualities; ++quality) {
+        synthLatencies[quality] = juce::roundToInt(lanes[0]->synthOversamplers[quality]->getLatencyInSamples());
+    }
+
+    //room for the longest lookahead and synth latency so switching between them never allocates, then tell the host where we start
+    lookaheadWindowSamples = analysisWindowSize * analysisFactor;
+    lookahead.prepare(numChannels, getLookaheadSamples(static_cast<int>(lookaheadWindows.size()) - 1)
+        + *std::max_element(synthLatencies.begin(), synthLatencies.end()));
+    pitchSource = juce::jlimit(0, numPitchSources - 1, static_cast<int>(params.pitchSource->load()));
+    lookaheadMode = pitchSource == midiPitch ? 0 : static_cast<int>(params.lookahead->load());
+    synthQuality = juce::jlimit(0, numSynthQualities - 1, static_cast<int>(params.synthQuality->load()));
+    lookahead.setDelay(getAudioDelaySamples(lookaheadMode, synthQuality));
+    lookahead.reset();
+    for (int lane = 0; lane < numLanes; ++lane) {
+        auto& gateGainDelay = lanes[lane]->gateGainDelay;
+        gateGainDelay.prepare(1, lookahead.getMaximumDelay());
+        gateGainDelay.setDelay(lookahead.getDelay());
+        gateGainDelay.reset();
+        lanes[lane]->delayedGateGain = 0.0f;
+    }
+    reportedLatency = lookahead.getDelay();
+    notifiedLatency = reportedLatency.load();
+    setLatencySamples(notifiedLatency);
+    activeFilterEngine = -1; //the first block sets the state variable banks straight onto the pitch
+    activeNumLanes = 0;
+    activeHarmonicCount = -1;
+    activePitchSource = pitchSource;
+
+    //start the smoothers sitting on the current knob positions
+    for (auto* level : { &evenSynthLevel, &oddSynthLevel }) {
+        level->reset(sampleRate, PARAMETER_SMOOTHING_SECONDS);
+    }
+    for (auto* cutoff : { &evenLP, &oddLP }) {
+        cutoff->reset(sampleRate, PARAMETER_SMOOTHING_SECONDS);
+    }
+    for (auto* gain : { &svfFundamentalDb, &svfOddDb, &svfEvenDb }) {
+        gain->reset(sampleRate, PARAMETER_SMOOTHING_SECONDS);
+    }
+    updateBlockParameters();
+    for (auto* level : { &evenSynthLevel, &oddSynthLevel }) {
+        level->setCurrentAndTargetValue(level->getTargetValue());
+    }
+    for (auto* cutoff : { &evenLP, &oddLP }) {
+        cutoff->setCurrentAndTargetValue(cutoff->getTargetValue());
+    }
+
+    //everything is in place, let the workers loose
+    startAnalysis();
+}
+
+void Harmonicator9000AudioProcessor::prepareLane(AnalysisLane& lane, const juce::dsp::ProcessSpec& spec, int numChannels) {
+    //size the pitch detectors for our window and the range of notes we track
+    const double analysisRate = sampleRate / analysisFactor;
+    lane.analysisDecimator.prepare(analysisFactor);
+    for (auto& detector : lane.pitchDetectors) {
+        detector->prepare(analysisRate, analysisWindowSize, MINIMUM_FREQ, MAX_FREQ);
+    }
+    lane.currentCoefs.fill(allPassCoefs);
+    lane.bandFreqIndex.fill(-1);
+    lane.bandGainIndex.fill(-1);
+    lane.midiCoefs.fill(allPassCoefs);
+    lane.midiBandFreqIndex.fill(-1);
+    lane.midiBandGainIndex.fill(-1);
+    lane.numHeldNotes = 0;
+    lane.midiFreq = lane.fundamentalFreq.load();
+    lane.emittedNote = -1;
+
+    //get the oscillators' tables ready, and a pair of low pass filters and an oversampler for every synth quality
+    lane.squareOsc.prepare(sampleRate, static_cast<int>(spec.maximumBlockSize), MINIMUM_FREQ, MAX_FREQ, MAX_SYNTH_OVERSAMPLING);
+    lane.sawOsc.prepare(sampleRate, static_cast<int>(spec.maximumBlockSize), MINIMUM_FREQ, MAX_FREQ, MAX_SYNTH_OVERSAMPLING);
+    for (int quality = 0; quality < numSynthQualities; ++quality) {
+        auto oversampledSpec = spec;
+        oversampledSpec.sampleRate = spec.sampleRate * synthOversamplingFactors[quality];
+        oversampledSpec.maximumBlockSize = spec.maximumBlockSize * static_cast<juce::uint32>(synthOversamplingFactors[quality]);
+        for (auto* lowPass : { &lane.oddLowPass[quality], &lane.evenLowPass[quality] }) {
+            lowPass->setMode(juce::dsp::LadderFilterMode::LPF24);
+            lowPass->prepare(oversampledSpec);
+        }
+        if (lane.synthOversamplers[quality] != nullptr) {
+            lane.synthOversamplers[quality]->initProcessing(spec.maximumBlockSize);
+        }
+    }
+    lane.activeSynthQuality = -1;
+    lane.synthTailSamples = 0;
+    for (auto& cascade : lane.harmonicCascades) {
+        cascade->prepare(sampleRate, numChannels);
+    }
+    lane.svfFundamental.reset(sampleRate, SVF_GLIDE_SECONDS);
+    lane.envelope.prepare(sampleRate, PROCESS_QUANTUM);
+    lane.envelopeLevel = 0.0f;
+    lane.gateOpen = false;
+
+    getUserDefinedSettings(lane);
+    //start over with an empty ring, the first estimate comes once a whole window of whichever path is running is in
+    resetLaneAnalysis(lane, analysingOffline ? offlineWindowSize : analysisWindowSize);
+
+    //set up filters in a startup state so that the process block will actually work
+    updateFilters(lane);
+    lane.coefficientBuffer.update();
+    for (auto& cascade : lane.harmonicCascades) {
+        cascade->setCoefficients(lane.coefficientBuffer.getReadBuffer().data());
+    }
+    buildCoefficients(lane.midiFreq, lane.fundamentalVol, lane.oddHarmVol, lane.evenHarmVol, lane.harmonicCount,
+        lane.midiCoefs, lane.midiBandFreqIndex, lane.midiBandGainIndex);
 }
 
 void Harmonicator9000AudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    stopAnalysis();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -393,17 +665,16 @@ bool Harmonicator9000AudioProcessor::isBusesLayoutSupported (const BusesLayout&
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Mono, stereo or anything wider up to MAX_CHANNELS, every channel goes through
+    // the harmonic bands (and can follow its own pitch). Some plugin hosts, such as
+    // certain GarageBand versions, will only load plugins that support stereo bus layouts.
+    const auto mainOutput = layouts.getMainOutputChannelSet();
+    if (mainOutput.isDisabled() || mainOutput.size() > MAX_CHANNELS)
         return false;
 
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+    if (mainOutput != layouts.getMainInputChannelSet())
         return false;
    #endif
 
@@ -412,9 +683,17 @@ bool Harmonicator9000AudioProcessor::isBusesLayoutSupported (const BusesLayout&
 }
 #endif
 
+juce::dsp::AudioBlock<float> Harmonicator9000AudioProcessor::getLaneBlock(const juce::dsp::AudioBlock<float>& block, int lane) const noexcept {
+    return numActiveLanes > 1 ? block.getSingleChannelBlock(static_cast<size_t>(lane)) : block;
+}
+
 void Harmonicator9000AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    //in the test harness, anything below that allocates, locks or starts a thread gets counted (offline renders have no deadline)
+    RT_SAFETY_CALLBACK(!isNonRealtime());
+    bool gateWasOpen = false; //filled in once the block has looked at the gate
+    PerformanceMetrics::ScopedBlockTimer blockTimer(metrics, buffer.getNumSamples(), gateWasOpen);
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -429,114 +708,453 @@ void Harmonicator9000AudioProcessor::processBlock (juce::AudioBuffer<float>& buf
 
 
     
-    //generate and filter the buffers from each synth engine, then just add them in in the below processing (might need to thread this later)
-    if (evenSynthVol > -100.0 && avgVol > CRITICAL_VOLUME_THRESH) {
-        evenLowPass.setCutoffFrequencyHz(evenLP);
-        getNextSquare();
-        //wrap the buffer in a context (this is how JUCE needs it to happen apperantly)
-        jassert(squareOutBuff.data() != nullptr);
-        std::vector<float*> filterData = { squareOutBuff.data() };
-        juce::dsp::AudioBlock<float> squareBlock(filterData.data(), 1, squareOutBuff.size());
-        juce::dsp::ProcessContextReplacing<float> context(squareBlock);
-        //filter it
-        evenLowPass.process(context);
+    //the dry input for the analyzer, before anything below touches the buffer
+    analyzerFifo.push(AnalyzerFifo::inputStream, totalNumInputChannels > 0 ? buffer.getReadPointer(0) : nullptr, buffer.getNumSamples());
+
+    //this block's knob values, read once up here so everything below sees the same ones
+    RT_SAFETY_SITE("processBlock/parameters");
+    updateBlockParameters();
+
+    //a new pitch source hands every lane's filters over to the other side
+    if (pitchSource != activePitchSource) {
+        for (int lane = 0; lane < numLanes; ++lane) {
+            applyLaneCoefficients(*lanes[lane]);
+        }
+        activePitchSource = pitchSource;
     }
-    if (oddSynthVol > -100.0 && avgVol > CRITICAL_VOLUME_THRESH) {
-        oddLowPass.setCutoffFrequencyHz(oddLP);
-        getNextSaw();
+    //if the workers have published new coefficients, copy them into the filters. A lane MIDI is steering keeps its
+    //own, rebuilt here if a knob moved them
+    for (int laneIndex = 0; laneIndex < numActiveLanes; ++laneIndex) {
+        auto& lane = *lanes[laneIndex];
+        const bool published = lane.coefficientBuffer.update();
+        if (isMidiSteered(lane)) {
+            if (buildCoefficients(lane.midiFreq, params.fundamental->load(), params.oddHarmonics->load(), params.evenHarmonics->load(),
+                harmonicCount, lane.midiCoefs, lane.midiBandFreqIndex, lane.midiBandGainIndex)) {
+                applyCoefficients(lane, lane.midiCoefs);
+            }
+        }
+        else if (published) {
+            applyCoefficients(lane, lane.coefficientBuffer.getReadBuffer());
+        }
+    }
+    //hand the dry input to the analysis, each channel to its own lane, or all of them mixed down to one
+    RT_SAFETY_SITE("processBlock/analysis hand-off");
+    switchAnalysisPath(isNonRealtime());
+    const int numSamples = buffer.getNumSamples();
+    if (pitchSource == midiPitch) {
+        //MIDI is setting the pitch, there is no analysis to feed
+    }
+    else if (numActiveLanes > 1) {
+        for (int lane = 0; lane < numActiveLanes; ++lane) {
+            feedAnalysis(*lanes[lane], buffer.getReadPointer(lane), numSamples);
+        }
+    }
+    else if (totalNumInputChannels <= 1) {
+        feedAnalysis(*lanes[0], totalNumInputChannels == 1 ? buffer.getReadPointer(0) : nullptr, totalNumInputChannels == 1 ? numSamples : 0);
+    }
+    else {
+        //the mix buffer is one quantum long, go round in pieces
+        const int mixBlockSize = static_cast<int>(analysisMixBuff.size());
+        const float channelGain = 1.0f / static_cast<float>(totalNumInputChannels);
+        for (int offset = 0; offset < numSamples; offset += mixBlockSize) {
+            const int numToMix = juce::jmin(mixBlockSize, numSamples - offset);
+            juce::FloatVectorOperations::copyWithMultiply(analysisMixBuff.data(), buffer.getReadPointer(0, offset), channelGain, numToMix);
+            for (int channel = 1; channel < totalNumInputChannels; ++channel) {
+                juce::FloatVectorOperations::addWithMultiply(analysisMixBuff.data(), buffer.getReadPointer(channel, offset), channelGain, numToMix);
+            }
+            feedAnalysis(*lanes[0], analysisMixBuff.data(), numToMix);
+        }
+    }
+    //set how far the audio path runs behind the analysis, renderQuantum runs the delay itself a quantum at a time
+    //(after the gate has had the undelayed input)
+    RT_SAFETY_SITE("processBlock/latency");
+    const int delaySamples = getAudioDelaySamples(lookaheadMode, synthQuality);
+    const bool latencyMoved = delaySamples != lookahead.getDelay();
+    if (latencyMoved) {
+        lookahead.setDelay(delaySamples);
+        for (int lane = 0; lane < numLanes; ++lane) {
+            lanes[lane]->gateGainDelay.setDelay(delaySamples);
+        }
+        reportedLatency = lookahead.getDelay(); //the worker passes it on, posting the message takes a lock
+    }
+    if (isNonRealtime()) {
+        passOnLatency();
+    }
+    else if (pitchSource != midiPitch) {
+        //wake every worker with a lane to run, even with no input they pick up knob changes
+        for (int worker = 0; worker < juce::jmin(numWorkers, numActiveLanes); ++worker) {
+            analysisWorkers[worker]->wake.release();
+        }
+    }
+    else if (latencyMoved) {
+        analysisWorkers[0]->wake.release(); //the workers sleep while MIDI has the pitch, this one just passes on the latency
+    }
+
+    //play the block a quantum at a time whatever size the host hands us, so the scratch buffers stay small and the
+    //smoothers and synth gains move every PROCESS_QUANTUM samples. Quanta sit on a fixed grid from the block start
+    //and get cut short where a note lands, so it retunes the bands and synths right there
+    int renderedUpTo = 0;
+    auto renderUpTo = [&](int end) {
+        while (renderedUpTo < end) {
+            const int quantumEnd = juce::jmin(end, (renderedUpTo / PROCESS_QUANTUM + 1) * PROCESS_QUANTUM);
+            renderQuantum(buffer, renderedUpTo, quantumEnd - renderedUpTo, gateWasOpen);
+            renderedUpTo = quantumEnd;
+        }
+    };
+    for (const auto metadata : midiMessages) {
+        if (pitchSource != detectedPitch) {
+            renderUpTo(juce::jlimit(renderedUpTo, numSamples, metadata.samplePosition));
+        }
+        handleMidiEvent(metadata.getMessage());
+    }
+    renderUpTo(numSamples);
+    emitDetectedNotes(midiMessages);
+    analyzerFifo.push(AnalyzerFifo::outputStream, buffer.getReadPointer(0), numSamples);
+}
+
+void Harmonicator9000AudioProcessor::renderQuantum(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, bool& gateWasOpen) noexcept {
+    const int totalNumInputChannels = getTotalNumInputChannels();
+
+    jassert(numSamples <= PROCESS_QUANTUM); //the scratch buffers hold one quantum
+    //the knob side of the synths is the same for every lane, gain is worked out once per quantum (from where the
+    //smoothers land at the end of it) and the oscillators ramp to it
+    const auto mode = static_cast<OscillatorMode>(juce::jlimit(0, static_cast<int>(OscillatorMode::numModes) - 1, oscillatorMode));
+    const float squareLevel = evenSynthLevel.skip(numSamples);
+    const float sawLevel = oddSynthLevel.skip(numSamples);
+    const float evenCutoff = evenLP.skip(numSamples);
+    const float oddCutoff = oddLP.skip(numSamples);
+
+    //generate and filter the buffers from each synth engine, then add them in
+    auto renderSynth = [&](SynthOscillator& osc, juce::dsp::LadderFilter<float>& lowPass, float* out,
+        float freq, float gain, int renderSamples) {
+        osc.process(out, renderSamples, freq, gain, mode);
         //wrap the buffer in a context (this is how JUCE needs it to happen apperantly)
-        jassert(sawOutBuff.data() != nullptr);
-        std::vector<float*> filterData = { sawOutBuff.data() };
-        juce::dsp::AudioBlock<float> sawBlock(filterData.data(), 1, sawOutBuff.size());
-        juce::dsp::ProcessContextReplacing<float> context(sawBlock);
+        float* filterData[] = { out };
+        juce::dsp::AudioBlock<float> synthBlock(filterData, 1, static_cast<size_t>(renderSamples));
+        juce::dsp::ProcessContextReplacing<float> context(synthBlock);
         //filter it
-        oddLowPass.process(context);
-    }
-    //if coefficients are done cooking, update the filters
-    if (coefficientsRdy == true) {
-        fundamentalBandL.coefficients = fundamentalCoefs;
-        firstOddBandL.coefficients = oddOneCoefs;
-        secondOddBandL.coefficients = oddTwoCoefs;
-        thirdOddBandL.coefficients = oddThreeCoefs;
-        //fourthOddBand_groupA.process(harmContext);
-        firstEvenBandL.coefficients = evenOneCoefs;
-        secondEvenBandL.coefficients = evenTwoCoefs;
-        thirdEvenBandL.coefficients = evenThreeCoefs;
-        //fourthEvenBand_groupA.process(harmContext);
-        fundamentalBandR.coefficients = fundamentalCoefs;
-        firstOddBandR.coefficients = oddOneCoefs;
-        secondOddBandR.coefficients = oddTwoCoefs;
-        thirdOddBandR.coefficients = oddThreeCoefs;
-        //fourthOddBand_groupA.process(harmContext);
-        firstEvenBandR.coefficients = evenOneCoefs;
-        secondEvenBandR.coefficients = evenTwoCoefs;
-        thirdEvenBandR.coefficients = evenThreeCoefs;
-        //fourthEvenBand_groupA.process(harmContext);
-        coefficientsRdy = false;
-    }
-    //if things have changed, spawn a new filter thread
-    if ((!coefficientsRdy) && 
-        !((lastFundVol == fundamentalVol) && (lastFreq == fundamentalFreq) && 
-            (lastOddVol == oddHarmVol) && (lastEvenVol == evenHarmVol))) {
-        std::thread filterThread(&Harmonicator9000AudioProcessor::updateFilters, this);
-        filterThread.detach(); //let the thread go frolic on its own   
-    }
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        auto* channelData = buffer.getWritePointer(channel);
-        //here: call a function that will add the sample to the DSP FIFO, increment the counter, set the
-        //boolean if we are ready to do the calc (and reset the pointer)
-        for (int i = 0; i < buffer.getNumSamples(); ++i) {
-            if (channel == 1) {
-                //process at higher gain for less float resolution error in pich calculation
-                addToCorr(channelData[i] * 8); //only process one channel for frequency or the buffers will get messed up
+        lowPass.process(context);
+    };
+    //a lane plays into its own channel, or every input channel when it follows the whole bus
+    auto getLaneChannels = [&](int laneIndex) {
+        return std::make_pair(numActiveLanes > 1 ? laneIndex : 0, numActiveLanes > 1 ? laneIndex + 1 : totalNumInputChannels);
+    };
+    RT_SAFETY_SITE("processBlock/gate");
+    for (int laneIndex = 0; laneIndex < numActiveLanes; ++laneIndex) {
+        auto& lane = *lanes[laneIndex];
+        const auto [firstChannel, endChannel] = getLaneChannels(laneIndex);
+        //follow the loudest of the lane's channels while they are still the undelayed input, so the workers' pitch
+        //checks see the gate open as the note arrives and the lookahead has something to look ahead for
+        std::array<const float*, MAX_CHANNELS> laneChannels{};
+        for (int channel = firstChannel; channel < endChannel; ++channel) {
+            laneChannels[channel - firstChannel] = buffer.getReadPointer(channel, startSample);
+        }
+        lane.envelopeLevel = lane.envelope.process(laneChannels.data(), endChannel - firstChannel, numSamples);
+        //once open it stays open until the level falls the hysteresis below the threshold
+        const bool envelopeGate = lane.envelopeLevel > (lane.gateOpen.load(std::memory_order_relaxed) ? gateCloseLevel : gateOpenLevel);
+        lane.gateOpen.store(envelopeGate, std::memory_order_relaxed);
+        //only the gain it gives the synths waits for the audio
+        std::fill_n(gateGainBuff.data(), numSamples, envelopeGate ? lane.envelopeLevel : 0.0f);
+        float* gainData[] = { gateGainBuff.data() };
+        juce::AudioBuffer<float> gainBlock(gainData, 1, numSamples);
+        lane.gateGainDelay.process(gainBlock, 1);
+        lane.delayedGateGain = gateGainBuff[static_cast<size_t>(numSamples - 1)];
+    }
+
+    //run the audio path behind the analysis by the lookahead, so the filters have moved by the time the note comes
+    //out. The ring runs with lookahead off too, so turning it on picks up the audio we just played rather than
+    //whatever was left from last time
+    RT_SAFETY_SITE("processBlock/lookahead");
+    std::array<float*, MAX_CHANNELS> quantumChannels{};
+    for (int channel = 0; channel < totalNumInputChannels; ++channel) {
+        quantumChannels[channel] = buffer.getWritePointer(channel, startSample);
+    }
+    juce::AudioBuffer<float> quantumBlock(quantumChannels.data(), totalNumInputChannels, numSamples);
+    lookahead.process(quantumBlock, totalNumInputChannels);
+
+    RT_SAFETY_SITE("processBlock/synths");
+    for (int laneIndex = 0; laneIndex < numActiveLanes; ++laneIndex) {
+        auto& lane = *lanes[laneIndex];
+        const auto [firstChannel, endChannel] = getLaneChannels(laneIndex);
+        //the gate as it stood when the audio coming out now went in
+        const float delayedGain = lane.delayedGateGain;
+
+        //take one look at the lane's gate and pitch for the whole quantum so both synths and the mix below agree,
+        //a closed gate or a knob at -100 ramps them down to silence. A held note opens the gate at its velocity,
+        //in MIDI mode nothing else does. Otherwise the synths play at the envelope's level, ramping to it every quantum
+        const bool noteHeld = pitchSource != detectedPitch && lane.numHeldNotes > 0;
+        const bool gateOpen = noteHeld || (pitchSource != midiPitch && delayedGain > 0.0f);
+        gateWasOpen = gateWasOpen || gateOpen;
+        const float synthFreq = getLanePitch(lane);
+        const float synthVolume = noteHeld ? lane.heldNotes[lane.numHeldNotes - 1].velocity : (gateOpen ? delayedGain : 0.0f);
+        const float squareGain = squareLevel * synthVolume;
+        const float sawGain = sawLevel * synthVolume;
+        const bool squareOn = squareGain > 0.0f || !lane.squareOsc.isSilent();
+        const bool sawOn = sawGain > 0.0f || !lane.sawOsc.isSilent();
+        const bool synthsOn = squareOn || sawOn;
+        if (!synthsOn && lane.synthTailSamples <= 0) {
+            continue; //nothing playing and nothing left in the oversampler, spend nothing on this lane
+        }
+        auto* oversampler = lane.synthOversamplers[synthQuality].get();
+        auto& evenLowPass = lane.evenLowPass[synthQuality];
+        auto& oddLowPass = lane.oddLowPass[synthQuality];
+        //a new rate, or coming back from idle, starts that rate's filters and oversampler from silence
+        if (lane.activeSynthQuality != synthQuality || lane.synthTailSamples <= 0) {
+            evenLowPass.reset();
+            oddLowPass.reset();
+            if (oversampler != nullptr) {
+                oversampler->reset();
+            }
+            lane.squareOsc.setOversampling(synthOversamplingFactors[synthQuality]);
+            lane.sawOsc.setOversampling(synthOversamplingFactors[synthQuality]);
+            lane.activeSynthQuality = synthQuality;
+        }
+        //once both synths are silent, keep going just long enough to play out what the oversampler is holding
+        lane.synthTailSamples = synthsOn ? synthLatencies[synthQuality] + 1 : lane.synthTailSamples - numSamples;
+        evenLowPass.setCutoffFrequencyHz(evenCutoff);
+        oddLowPass.setCutoffFrequencyHz(oddCutoff);
+        //both synths end up summed in synthOut, at the host rate or in the oversampler's own buffer
+        float* synthOut = squareOutBuff.data();
+        int renderSamples = numSamples;
+        if (oversampler != nullptr) {
+            //nothing needs upsampling since the synths are generated at the high rate, but the oversampler only
+            //hands out its buffer on the way up, so it gets silence and we write over whatever comes out
+            juce::FloatVectorOperations::clear(squareOutBuff.data(), numSamples);
+            const float* silence[] = { squareOutBuff.data() };
+            auto upBlock = oversampler->processSamplesUp(juce::dsp::AudioBlock<const float>(silence, 1, static_cast<size_t>(numSamples)));
+            synthOut = upBlock.getChannelPointer(0);
+            renderSamples = static_cast<int>(upBlock.getNumSamples());
+        }
+        if (squareOn) {
+            renderSynth(lane.squareOsc, evenLowPass, synthOut, synthFreq, squareGain, renderSamples);
+        }
+        else {
+            juce::FloatVectorOperations::clear(synthOut, renderSamples);
+        }
+        if (sawOn) {
+            renderSynth(lane.sawOsc, oddLowPass, sawOutBuff.data(), synthFreq, sawGain, renderSamples);
+            juce::FloatVectorOperations::add(synthOut, sawOutBuff.data(), renderSamples);
+        }
+        if (oversampler != nullptr) {
+            float* downData[] = { squareOutBuff.data() };
+            juce::dsp::AudioBlock<float> downBlock(downData, 1, static_cast<size_t>(numSamples));
+            oversampler->processSamplesDown(downBlock);
+        }
+        for (int channel = firstChannel; channel < endChannel; ++channel) {
+            juce::FloatVectorOperations::add(buffer.getWritePointer(channel, startSample), squareOutBuff.data(), numSamples);
+        }
+    }
+    //process the audio through the harmonic filtering
+    RT_SAFETY_SITE("processBlock/harmonic bands");
+    auto harmBlock = juce::dsp::AudioBlock<float>(buffer).getSubBlock(static_cast<size_t>(startSample), static_cast<size_t>(numSamples));
+    processHarmonicBands(harmBlock);
+}
+
+void Harmonicator9000AudioProcessor::processBlockBypassed(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    //bypassed we still owe the host the latency we reported, so the dry signal goes through the same delay
+    RT_SAFETY_CALLBACK(!isNonRealtime());
+    for (auto i = getTotalNumInputChannels(); i < getTotalNumOutputChannels(); ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+    lookahead.process(buffer, getTotalNumInputChannels());
+}
+
+void Harmonicator9000AudioProcessor::processHarmonicBands(juce::dsp::AudioBlock<float>& harmBlock) noexcept {
+    //a bank that has been sitting idle, or was following a different set of channels, holds the tail of
+    //whatever it last played, start it from silence. A different size of cascade also needs the latest coefficients,
+    //the worker fills in any bands it didn't have before on its next pass
+    if (filterEngine != activeFilterEngine || numActiveLanes != activeNumLanes || harmonicCount != activeHarmonicCount) {
+        for (int laneIndex = 0; laneIndex < numActiveLanes; ++laneIndex) {
+            auto& lane = *lanes[laneIndex];
+            lane.harmonicCascades[harmonicCount]->reset();
+            if (filterEngine == svfEngine) {
+                lane.svfFundamental.setCurrentAndTargetValue(lane.svfFundamental.getTargetValue());
             }
-            if (evenSynthVol > -100.0 && avgVol > CRITICAL_VOLUME_THRESH) {
-                channelData[i] += squareOutBuff[i];
+            else {
+                applyLaneCoefficients(lane);
             }
-            if (oddSynthVol > -100.0 && avgVol > CRITICAL_VOLUME_THRESH) {
-                channelData[i] += sawOutBuff[i];
+        }
+        if (filterEngine == svfEngine) {
+            for (auto* smoother : { &svfFundamentalDb, &svfOddDb, &svfEvenDb }) {
+                smoother->setCurrentAndTargetValue(smoother->getTargetValue());
             }
-            channelData[i] = channelData[i]; //vol reduction to prevent peaking
-        }
-        ////process the audio through the harmonic filtering
-        //std::vector<float*> harmFiltData = { channelData };
-        //juce::dsp::AudioBlock<float> harmBlock(harmFiltData.data(), 1, buffer.getNumSamples());
-        //juce::dsp::ProcessContextReplacing<float> harmContext(harmBlock);
-        //fundamentalBand.process(harmContext);
-        //firstOddBand.process(harmContext);
-        //secondOddBand.process(harmContext);
-        //thirdOddBand.process(harmContext);
-        ////fourthOddBand_groupA.process(harmContext);
-        //firstEvenBand.process(harmContext);
-        //secondEvenBand.process(harmContext);
-        //thirdEvenBand.process(harmContext);
-        ////fourthEvenBand_groupA.process(harmContext);
+        }
+        activeFilterEngine = filterEngine;
+        activeNumLanes = numActiveLanes;
+        activeHarmonicCount = harmonicCount;
+    }
+    if (filterEngine == svfEngine) {
+        processSvfBands(harmBlock);
+    }
+    else {
+        for (int lane = 0; lane < numActiveLanes; ++lane) {
+            auto laneBlock = getLaneBlock(harmBlock, lane);
+            lanes[lane]->harmonicCascades[harmonicCount]->processBiquads(laneBlock);
+        }
+    }
+}
+
+void Harmonicator9000AudioProcessor::processSvfBands(juce::dsp::AudioBlock<float>& harmBlock) noexcept {
+    //glide the pitch and band gains a sub block at a time and retune every section as we go, the state variable
+    //filters don't mind their coefficients moving under them so there is nothing to hand over or throttle
+    const int numSamples = static_cast<int>(harmBlock.getNumSamples());
+    for (int offset = 0; offset < numSamples; offset += SVF_UPDATE_INTERVAL) {
+        const int subBlockSize = juce::jmin(SVF_UPDATE_INTERVAL, numSamples - offset);
+        const float fundGain = juce::Decibels::decibelsToGain(svfFundamentalDb.skip(subBlockSize));
+        const float oddGain = juce::Decibels::decibelsToGain(svfOddDb.skip(subBlockSize));
+        const float evenGain = juce::Decibels::decibelsToGain(svfEvenDb.skip(subBlockSize));
+        auto subBlock = harmBlock.getSubBlock(static_cast<size_t>(offset), static_cast<size_t>(subBlockSize));
+        for (int laneIndex = 0; laneIndex < numActiveLanes; ++laneIndex) {
+            auto& lane = *lanes[laneIndex];
+            auto& cascade = *lane.harmonicCascades[harmonicCount];
+            cascade.tuneSvf(lane.svfFundamental.skip(subBlockSize), static_cast<float>(FILTER_QUALITY), fundGain, oddGain, evenGain);
+            auto laneBlock = getLaneBlock(subBlock, laneIndex);
+            cascade.processSvfs(laneBlock);
+        }
+    }
+}
+
+//==============================================================================
+//MIDI pitch, everything in here runs on the audio thread
+
+//the note's frequency, moved by octaves until it is inside the range the bands and detectors cover
+static float getFoldedNoteFrequency(int noteNumber) noexcept {
+    float freq = static_cast<float>(juce::MidiMessage::getMidiNoteInHertz(noteNumber));
+    while (freq > MAX_FREQ) {
+        freq *= 0.5f;
+    }
+    while (freq < MINIMUM_FREQ) {
+        freq *= 2.0f;
+    }
+    return freq;
+}
+
+bool Harmonicator9000AudioProcessor::isMidiSteered(const AnalysisLane& lane) const noexcept {
+    //MIDI mode keeps the last note after the release, the fallback goes back to detecting
+    return pitchSource == midiPitch || (pitchSource == midiWithFallbackPitch && lane.numHeldNotes > 0);
+}
+
+float Harmonicator9000AudioProcessor::getLanePitch(const AnalysisLane& lane) const noexcept {
+    return isMidiSteered(lane) ? lane.midiFreq : lane.fundamentalFreq.load();
+}
+
+void Harmonicator9000AudioProcessor::applyLaneCoefficients(AnalysisLane& lane) noexcept {
+    if (!isMidiSteered(lane)) {
+        applyCoefficients(lane, lane.coefficientBuffer.getReadBuffer());
+        lane.svfFundamental.setTargetValue(lane.fundamentalFreq.load()); //glide back to the detected pitch
+        return;
+    }
+    buildCoefficients(lane.midiFreq, params.fundamental->load(), params.oddHarmonics->load(), params.evenHarmonics->load(),
+        harmonicCount, lane.midiCoefs, lane.midiBandFreqIndex, lane.midiBandGainIndex);
+    applyCoefficients(lane, lane.midiCoefs);
+    //the note is known exactly, so the state variable bells jump straight to it instead of gliding
+    lane.svfFundamental.setCurrentAndTargetValue(lane.midiFreq);
+}
+
+void Harmonicator9000AudioProcessor::handleMidiEvent(const juce::MidiMessage& message) noexcept {
+    //tracking per channel, MIDI channel 1 plays lane 0, channel 2 lane 1 and so on round the lanes
+    const int laneIndex = numActiveLanes > 1 ? (message.getChannel() - 1) % numActiveLanes : 0;
+    auto& lane = *lanes[laneIndex];
+    const bool wasSteered = isMidiSteered(lane);
+    const float lastFreq = lane.midiFreq;
+
+    //a note already held comes off the stack before it goes back on top
+    auto removeNote = [&lane](int noteNumber) {
+        int kept = 0;
+        for (int i = 0; i < lane.numHeldNotes; ++i) {
+            if (lane.heldNotes[i].noteNumber != noteNumber) {
+                lane.heldNotes[kept++] = lane.heldNotes[i];
+            }
+        }
+        lane.numHeldNotes = kept;
+    };
+    if (message.isNoteOn()) {
+        removeNote(message.getNoteNumber());
+        if (lane.numHeldNotes == MIDI_NOTE_STACK_SIZE) {
+            //out of room, forget the oldest
+            std::move(lane.heldNotes.begin() + 1, lane.heldNotes.end(), lane.heldNotes.begin());
+            lane.numHeldNotes--;
+        }
+        lane.heldNotes[lane.numHeldNotes++] = { message.getNoteNumber(), message.getFloatVelocity() };
+    }
+    else if (message.isNoteOff()) {
+        removeNote(message.getNoteNumber());
+    }
+    else if (message.isAllNotesOff() || message.isAllSoundOff()) {
+        lane.numHeldNotes = 0;
+    }
+    else {
+        return;
+    }
+    if (lane.numHeldNotes > 0) {
+        lane.midiFreq = getFoldedNoteFrequency(lane.heldNotes[lane.numHeldNotes - 1].noteNumber);
+    }
+    //only retune if the note actually moved or the lane went over to the other side
+    if (isMidiSteered(lane) != wasSteered || (wasSteered && lane.midiFreq != lastFreq)) {
+        applyLaneCoefficients(lane);
+    }
+}
+
+void Harmonicator9000AudioProcessor::emitDetectedNotes(juce::MidiBuffer& midiMessages) noexcept {
+    //sending notes replaces the notes that came in, everything else (controllers, clock...) passes through. Otherwise
+    //the input passes through untouched, bar any note offs we owe
+    const bool sending = midiOut && pitchSource != midiPitch;
+    if (sending) {
+        //more than our buffer can sort through without growing, leave it alone and try again next block
+        if (midiMessages.data.size() > MIDI_OUT_BUFFER_BYTES) {
+            return;
+        }
+        midiThroughBuff.clear();
+        for (const auto metadata : midiMessages) {
+            const auto message = metadata.getMessage();
+            if (!message.isNoteOn() && !message.isNoteOff()) {
+                midiThroughBuff.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition);
+            }
+        }
+        //this only ever shrinks the host's buffer, so there is always room to put the rest back
+        midiMessages.clear();
+        midiMessages.addEvents(midiThroughBuff, 0, -1, 0);
+    }
+
+    //our notes go into our own buffer first (reserved in prepareToPlay), so we know how much room they need
+    midiOutBuff.clear();
+    std::array<int, MAX_CHANNELS> notes;
+    for (int laneIndex = 0; laneIndex < numLanes; ++laneIndex) {
+        auto& lane = *lanes[laneIndex];
+        //a lane sounds its detected note while its gate is open, not while MIDI is steering it
+        int note = -1;
+        if (sending && laneIndex < numActiveLanes && !isMidiSteered(lane) && lane.gateOpen.load(std::memory_order_relaxed)) {
+            const float semitones = 12.0f * std::log2(lane.fundamentalFreq.load() / 440.0f);
+            note = juce::jlimit(0, 127, juce::roundToInt(69.0f + semitones));
+        }
+        notes[laneIndex] = note;
+        if (note == lane.emittedNote) {
+            continue;
+        }
+        if (lane.emittedNote >= 0) {
+            midiOutBuff.addEvent(juce::MidiMessage::noteOff(lane.emittedChannel, lane.emittedNote), 0);
+        }
+        if (note >= 0) {
+            const float velocity = juce::jlimit(0.05f, 1.0f, lane.envelopeLevel);
+            midiOutBuff.addEvent(juce::MidiMessage::noteOn(numActiveLanes > 1 ? laneIndex + 1 : 1, note, velocity), 0);
+        }
+    }
+    if (midiOutBuff.isEmpty()) {
+        return;
+    }
+    //growing the host's buffer would allocate, if they don't fit in the room it already has they wait for the next
+    //block (the lanes keep what they last sent, so the same changes come round again)
+    if (midiMessages.data.size() + midiOutBuff.data.size() > midiMessages.data.getNumAllocated()) {
+        return;
+    }
+    midiMessages.addEvents(midiOutBuff, 0, -1, 0);
+    for (int laneIndex = 0; laneIndex < numLanes; ++laneIndex) {
+        auto& lane = *lanes[laneIndex];
+        if (notes[laneIndex] >= 0 && notes[laneIndex] != lane.emittedNote) {
+            lane.emittedChannel = numActiveLanes > 1 ? laneIndex + 1 : 1;
+        }
+        lane.emittedNote = notes[laneIndex];
     }
-    //process the audio through the harmonic filtering
-    juce::dsp::AudioBlock<float> harmBlock(buffer);
-    auto leftBlock = harmBlock.getSingleChannelBlock(0); //left channel
-    auto rightBlock = harmBlock.getSingleChannelBlock(1); //right channel
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
-    fundamentalBandL.process(leftContext);
-    firstOddBandL.process(leftContext);
-    secondOddBandL.process(leftContext);
-    thirdOddBandL.process(leftContext);
-    //fourthOddBand_groupA.process(harmContext);
-    firstEvenBandL.process(leftContext);
-    secondEvenBandL.process(leftContext);
-    thirdEvenBandL.process(leftContext);
-    //fourthEvenBand_groupA.process(harmContext);
-    fundamentalBandR.process(rightContext);
-    firstOddBandR.process(rightContext);
-    secondOddBandR.process(rightContext);
-    thirdOddBandR.process(rightContext);
-    //fourthOddBand_groupA.process(harmContext);
-    firstEvenBandR.process(rightContext);
-    secondEvenBandR.process(rightContext);
-    thirdEvenBandR.process(rightContext);
-    //fourthEvenBand_groupA.process(harmContext);
 }
 
 //==============================================================================
@@ -586,13 +1204,13 @@ Harmonicator9000AudioProcessor::createParameterLayout() {
         "Odd Synth", -100.0, 0.0, -100.0));
 
     layout.add(std::make_unique<juce::AudioParameterFloat>("oddHarmonics",
-        "Odd Harmonics", -15.0, 15.0, 0.0));
+        "Odd Harmonics", -BAND_GAIN_RANGE_DB, BAND_GAIN_RANGE_DB, 0.0));
 
     layout.add(std::make_unique<juce::AudioParameterFloat>("fundamental",
-        "Fundamental Frequency", -15.0, 15.0, 0.0));
+        "Fundamental Frequency", -BAND_GAIN_RANGE_DB, BAND_GAIN_RANGE_DB, 0.0));
 
     layout.add(std::make_unique<juce::AudioParameterFloat>("evenHarmonics",
-        "Even Harmonics", -15.0, 15.0, 0.0));
+        "Even Harmonics", -BAND_GAIN_RANGE_DB, BAND_GAIN_RANGE_DB, 0.0));
 
     layout.add(std::make_unique<juce::AudioParameterFloat>("evenSynth",
         "Even Synth", -100.0, 0.0, -100.0));
@@ -600,18 +1218,126 @@ Harmonicator9000AudioProcessor::createParameterLayout() {
     layout.add(std::make_unique<juce::AudioParameterFloat>("evenLowPass",
         "Even Low Pass", 100.0, 20000.0, 20000.0));
 
+    //not on the panel, which algorithm finds the fundamental (defaults to the original AMDF)
+    layout.add(std::make_unique<juce::AudioParameterChoice>("pitchDetector",
+        "Pitch Detector", PitchDetector::getModeNames(), static_cast<int>(PitchDetectorMode::amdf)));
+
+    //not on the panel either, how often the pitch is re-estimated (overlapping windows track fast lines better)
+    juce::StringArray hopNames;
+    for (auto hop : analysisHopSizes) {
+        hopNames.add(hop == LARGE_PITCH_ARRAY_SIZE ? juce::String("Whole Window") : juce::String(hop) + " Samples");
+    }
+    layout.add(std::make_unique<juce::AudioParameterChoice>("analysisHop",
+        "Analysis Hop", hopNames, 2));
+
+    //not on the panel either, how the synth oscillators keep their aliasing down
+    layout.add(std::make_unique<juce::AudioParameterChoice>("oscillatorMode",
+        "Oscillator Mode", SynthOscillator::getModeNames(), static_cast<int>(OscillatorMode::polyBlep)));
+
+    //not on the panel either, how far the audio runs behind the pitch analysis. Live waits one analysis window so the
+    //note is in the window by the time it is heard, render waits two so the pitch has also been confirmed
+    layout.add(std::make_unique<juce::AudioParameterChoice>("lookahead",
+        "Lookahead", juce::StringArray{ "Off", "Live", "Render" }, 0));
+
+    //not on the panel either, which harmonic bank runs (state variable bells follow the pitch every few samples)
+    layout.add(std::make_unique<juce::AudioParameterChoice>("filterEngine",
+        "Filter Engine", juce::StringArray{ "Biquad", "State Variable" }, static_cast<int>(biquadEngine)));
+
+    //not on the panel either, whether the whole bus follows one pitch or every channel tracks its own
+    layout.add(std::make_unique<juce::AudioParameterChoice>("pitchTracking",
+        "Pitch Tracking", juce::StringArray{ "Shared", "Per Channel" }, static_cast<int>(sharedTracking)));
+
+    //not on the panel either, how far the synths and their low pass filters are oversampled to keep their aliasing
+    //down. Anything above the host rate adds the oversampling filters' latency, reported along with the lookahead
+    layout.add(std::make_unique<juce::AudioParameterChoice>("synthQuality",
+        "Synth Quality", juce::StringArray{ "Host Rate", "Eco (2x)", "Normal (4x)", "High (8x)" }, static_cast<int>(hostRateSynth)));
+
+    //not on the panel either, how many odd and even harmonics get a band (the knobs set all of a kind together)
+    layout.add(std::make_unique<juce::AudioParameterChoice>("harmonicCount",
+        "Harmonics", juce::StringArray{ "3", "4", "8" }, static_cast<int>(threeHarmonics)));
+
+    //not on the panel either, where the pitch comes from. MIDI notes retune right where they land and open the gate
+    //at their velocity, with no detector running and no lookahead, the fallback detects between notes
+    layout.add(std::make_unique<juce::AudioParameterChoice>("pitchSource",
+        "Pitch Source", juce::StringArray{ "Detected", "MIDI", "MIDI + Detection" }, static_cast<int>(detectedPitch)));
+
+    //not on the panel either, send the detected pitch out as MIDI notes (one channel per lane when tracking per channel)
+    layout.add(std::make_unique<juce::AudioParameterBool>("midiOut", "MIDI Out", false));
+
+    //not on the panel either, the gate. An envelope follower on the input opens it above the threshold and closes
+    //it once the level falls the hysteresis below, and sets the synths' level while it is open. The default
+    //threshold is about where the old windowed average gate sat
+    layout.add(std::make_unique<juce::AudioParameterFloat>("gateThreshold",
+        "Gate Threshold", -80.0, 0.0, -35.0));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>("gateHysteresis",
+        "Gate Hysteresis", 0.0, 20.0, 6.0));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>("gateAttack",
+        "Gate Attack", juce::NormalisableRange<float>(0.1f, 100.0f, 0.0f, 0.4f), 2.0f));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>("gateRelease",
+        "Gate Release", juce::NormalisableRange<float>(5.0f, 2000.0f, 0.0f, 0.4f), 150.0f));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("gateDetector",
+        "Gate Detector", EnvelopeFollower::getModeNames(), static_cast<int>(EnvelopeMode::peak)));
+
     return layout;
 }
 
-void getUserDefinedSettings(juce::AudioProcessorValueTreeState& apvts) {
-    //populates all of the settings as they are defined in the GUI
-    Harmonicator9000AudioProcessor::oddLP = apvts.getRawParameterValue("oddLowPass")->load();
-    Harmonicator9000AudioProcessor::oddSynthVol = apvts.getRawParameterValue("oddSynth")->load();
-    Harmonicator9000AudioProcessor::oddHarmVol = apvts.getRawParameterValue("oddHarmonics")->load();
-    Harmonicator9000AudioProcessor::fundamentalVol = apvts.getRawParameterValue("fundamental")->load();
-    Harmonicator9000AudioProcessor::evenHarmVol = apvts.getRawParameterValue("evenHarmonics")->load();
-    Harmonicator9000AudioProcessor::evenSynthVol = apvts.getRawParameterValue("evenSynth")->load();
-    Harmonicator9000AudioProcessor::evenLP = apvts.getRawParameterValue("evenLowPass")->load();
+void Harmonicator9000AudioProcessor::getUserDefinedSettings(AnalysisLane& lane) noexcept {
+    //the band gains and detector as they are defined in the GUI
+    lane.oddHarmVol = params.oddHarmonics->load();
+    lane.fundamentalVol = params.fundamental->load();
+    lane.evenHarmVol = params.evenHarmonics->load();
+    lane.detectorMode = static_cast<int>(params.pitchDetector->load());
+    lane.harmonicCount = juce::jlimit(0, numHarmonicCounts - 1, static_cast<int>(params.harmonicCount->load()));
+    lane.workerBuildsCoefficients = static_cast<int>(params.filterEngine->load()) != svfEngine;
+    //the knob is in host samples, the ring runs at the analysis rate
+    const int hostHop = analysisHopSizes[juce::jlimit(0, static_cast<int>(analysisHopSizes.size()) - 1,
+        static_cast<int>(params.analysisHop->load()))];
+    lane.analysisHop = hostHop == LARGE_PITCH_ARRAY_SIZE ? analysisWindowSize : juce::jmax(1, hostHop / analysisFactor);
+}
+
+void Harmonicator9000AudioProcessor::updateBlockParameters() noexcept {
+    //one look at each knob per block, the smoothers take care of getting there
+    evenSynthLevel.setTargetValue(juce::Decibels::decibelsToGain(params.evenSynth->load()));
+    oddSynthLevel.setTargetValue(juce::Decibels::decibelsToGain(params.oddSynth->load()));
+    evenLP.setTargetValue(params.evenLowPass->load());
+    oddLP.setTargetValue(params.oddLowPass->load());
+    oscillatorMode = static_cast<int>(params.oscillatorMode->load());
+    pitchSource = juce::jlimit(0, numPitchSources - 1, static_cast<int>(params.pitchSource->load()));
+    midiOut = params.midiOut->load() >= 0.5f;
+    //a MIDI note doesn't need to be heard before it is played, so there is nothing to look ahead for
+    lookaheadMode = pitchSource == midiPitch ? 0 : static_cast<int>(params.lookahead->load());
+    synthQuality = juce::jlimit(0, numSynthQualities - 1, static_cast<int>(params.synthQuality->load()));
+    filterEngine = juce::jlimit(0, numFilterEngines - 1, static_cast<int>(params.filterEngine->load()));
+    harmonicCount = juce::jlimit(0, numHarmonicCounts - 1, static_cast<int>(params.harmonicCount->load()));
+    numActiveLanes = static_cast<int>(params.pitchTracking->load()) == perChannelTracking ? numLanes : 1;
+    gateOpenLevel = juce::Decibels::decibelsToGain(params.gateThreshold->load());
+    gateCloseLevel = juce::Decibels::decibelsToGain(params.gateThreshold->load() - params.gateHysteresis->load());
+    const auto gateMode = static_cast<EnvelopeMode>(juce::jlimit(0, static_cast<int>(EnvelopeMode::numModes) - 1,
+        static_cast<int>(params.gateDetector->load())));
+    for (int lane = 0; lane < numLanes; ++lane) {
+        lanes[lane]->svfFundamental.setTargetValue(getLanePitch(*lanes[lane]));
+        lanes[lane]->envelope.setTimes(params.gateAttack->load(), params.gateRelease->load());
+        lanes[lane]->envelope.setMode(gateMode);
+    }
+    svfFundamentalDb.setTargetValue(params.fundamental->load());
+    svfOddDb.setTargetValue(params.oddHarmonics->load());
+    svfEvenDb.setTargetValue(params.evenHarmonics->load());
+}
+
+int Harmonicator9000AudioProcessor::getLookaheadSamples(int mode) const noexcept {
+    return lookaheadWindows[juce::jlimit(0, static_cast<int>(lookaheadWindows.size()) - 1, mode)] * lookaheadWindowSamples;
+}
+
+int Harmonicator9000AudioProcessor::getAudioDelaySamples(int mode, int quality) const noexcept {
+    return getLookaheadSamples(mode) + synthLatencies[juce::jlimit(0, numSynthQualities - 1, quality)];
+}
+
+void Harmonicator9000AudioProcessor::handleAsyncUpdate() {
+    setLatencySamples(reportedLatency.load());
 }
 
 //==============================================================================
@@ -620,16 +1346,3 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new Harmonicator9000AudioProcessor();
 }
-
-float Harmonicator9000AudioProcessor::fundamentalFreq = 100.0; // Define static freq variable outside of the class
-float Harmonicator9000AudioProcessor::evenSynthVol = -100.0; //same with all the other adjustable variables
-float Harmonicator9000AudioProcessor::oddSynthVol = -100.0;
-float Harmonicator9000AudioProcessor::fundamentalVol = 0.0;
-float Harmonicator9000AudioProcessor::oddHarmVol = 0.0;
-float Harmonicator9000AudioProcessor::evenHarmVol = 0.0;
-float Harmonicator9000AudioProcessor::oddLP = 20000.0;
-float Harmonicator9000AudioProcessor::evenLP = 20000.0;
-int Harmonicator9000AudioProcessor::cycleTimeSamples = 1; //cycle time in samples (calculated based off frequency each time it changes, can never be 0)
-int Harmonicator9000AudioProcessor::squareNumSamples = 0; //number of samples square wave generator has spent in the current cycle
-int Harmonicator9000AudioProcessor::sawNumSamples = 0; //number of samples saw wave generator has spent in the current cycle
-float Harmonicator9000AudioProcessor::avgVol = 0.0;
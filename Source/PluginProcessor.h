@@ -9,37 +9,56 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <semaphore>
+#include "TripleBuffer.h"
+#include "PitchDetector.h"
+#include "OfflinePitchAnalysis.h"
+#include "PeakCoefficientTable.h"
+#include "HarmonicCascade.h"
+#include "SynthOscillator.h"
+#include "EnvelopeFollower.h"
+#include "Decimator.h"
+#include "LookaheadDelay.h"
+#include "RealtimeSafety.h"
+#include "PerformanceMetrics.h"
+#include "AnalyzerFifo.h"
 
-#define SMALL_PITCH_ARRAY_SIZE 200
-#define LARGE_PITCH_ARRAY_SIZE 2500
+#define SMALL_PITCH_ARRAY_SIZE 200 //AMDF reference length, in samples at 48k (the detector scales it to the analysis rate)
+#define LARGE_PITCH_ARRAY_SIZE 2500 //the longest pitch window we have room for, in analysis rate samples
+#define ANALYSIS_TARGET_RATE 6000.0 //the pitch analysis runs at the host rate divided down to about this
+#define ANALYSIS_WINDOW_SECONDS 0.052 //pitch window length, about two periods of MINIMUM_FREQ (what 2500 samples was at 48k)
+#define OFFLINE_WINDOW_SECONDS 0.104 //the window when rendering offline, twice as long for a steadier estimate
+#define OFFLINE_ANALYSIS_HOP 64 //host samples between pitch estimates when rendering offline, whatever the hop knob says
 #define CRITICAL_SAMPLE_SHIFT 5 //the amount of samples that are needed to trigger an actual change
-#define CRITICAL_VOLUME_THRESH 0.09 //avg input volume must be above this for any synth generation or frequency updating (basically a gate)
 #define FILTER_QUALITY 10.0 //define the Q for low pass filters on synth generators (adjust to taste)
 #define PITCH_DETECTION_THRESH 1.8 //must be at least this amount smaller for a new pitch to be registered
 #define MINIMUM_FREQ 40 //define the minimum and maximum frequencies servicable by the plugin (setup for bass, could add toggle in the future)
 #define MAX_FREQ 392
-void getUserDefinedSettings(juce::AudioProcessorValueTreeState& apvts);
+#define ANALYSIS_FIFO_SIZE 16384 //samples of headroom between the audio thread and the analysis worker (about a third of a second at 48k)
+#define BIQUAD_COEFFICIENT_COUNT 5 //b0, b1, b2, a1, a2 (JUCE normalizes a0 away)
+#define CACHE_LINE_SIZE 64 //state written by different threads starts on its own line of this size
+#define BAND_GAIN_RANGE_DB 15.0 //the harmonic band knobs go +/- this many dB
+#define MAX_BAND_HARMONIC 17 //highest harmonic any band sits on (the eighth odd band of the biggest cascade)
+#define MAX_ANALYSIS_HOP 512 //largest overlapping hop, the window keeps this much history in front of it for sliding updates
+#define ANALYSIS_RING_SIZE 4096 //power of two that fits a window plus MAX_ANALYSIS_HOP of history
+#define PARAMETER_SMOOTHING_SECONDS 0.05 //how long synth volume and low pass knob moves take to settle
+#define SVF_UPDATE_INTERVAL 16 //samples between retunes of the state variable harmonic bank
+#define PROCESS_QUANTUM 64 //most samples the engine renders at once, host blocks are cut into these (a multiple of SVF_UPDATE_INTERVAL)
+#define SVF_GLIDE_SECONDS 0.01 //how long the state variable bank takes to glide to a new fundamental
+#define MAX_CHANNELS 16 //widest bus we accept, per channel tracking runs a pitch lane for each one
+#define MAX_ANALYSIS_WORKERS 8 //most analysis threads one instance spreads its lanes over
+#define MAX_SYNTH_OVERSAMPLING 8 //the high quality synth path runs this many times the host rate
+#define MIDI_NOTE_STACK_SIZE 16 //held notes a lane remembers, the newest one plays (last note priority)
+#define MIDI_OUT_BUFFER_BYTES 2048 //room our own MIDI buffers get, the same as JUCE's plugin wrappers reserve for the host's
 
 //==============================================================================
 /**
 */
-class Harmonicator9000AudioProcessor  : public juce::AudioProcessor
+class Harmonicator9000AudioProcessor  : public juce::AudioProcessor,
+                                        private juce::AsyncUpdater
 {
 public:
 
-    //==============================================================================
-    static float fundamentalFreq;
-    static int cycleTimeSamples; //cycle time in samples (calculated based off frequency each time it changes)
-    static int squareNumSamples; //number of samples square wave generator has spent in the current cycle
-    static int sawNumSamples; //number of samples saw wave generator has spent in the current cycle
-    static float evenSynthVol;
-    static float oddSynthVol;
-    static float fundamentalVol;
-    static float oddHarmVol;
-    static float evenHarmVol;
-    static float oddLP;
-    static float evenLP;
-    static float avgVol; //average volume for the last few ms normalized between 0 and 1
     //==============================================================================
     Harmonicator9000AudioProcessor();
     ~Harmonicator9000AudioProcessor() override;
@@ -53,6 +72,7 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -81,73 +101,336 @@ public:
     juce::AudioProcessorValueTreeState apvts{ *this, nullptr, "Parameters",
     createParameterLayout()};
 
+    //the last fundamental this instance locked on to (safe to call from any thread, the GUI polls it)
+    float getFundamentalFreq() const noexcept { return lanes[0]->fundamentalFreq.load(std::memory_order_relaxed); }
+    //how hard this instance is working, the editor reads snapshots of it and dumps them to CSV
+    const PerformanceMetrics& getMetrics() const noexcept { return metrics; }
+    //the input and output of every block for the editor's spectrum analyzer, which switches it on and off
+    AnalyzerFifo& getAnalyzerFifo() noexcept { return analyzerFifo; }
+    //odd (and even) harmonics with a band under the current "harmonicCount" setting (any thread)
+    int getHarmonicsPerSide() const noexcept {
+        return harmonicsPerSide[juce::jlimit(0, numHarmonicCounts - 1, static_cast<int>(params.harmonicCount->load()))];
+    }
+
 private:
     //==============================================================================
-    
-    std::array<float, LARGE_PITCH_ARRAY_SIZE> largePitchArray; //two arrays to hold pitch, for running pitch threads twice as fast
-    std::array<float, SMALL_PITCH_ARRAY_SIZE> smallPitchArray;
-    std::array<float, LARGE_PITCH_ARRAY_SIZE> avgVolArray; //copy into this each time we start a new freq calc, will update avg. vol
-    std::vector<float> squareOutBuff; //these will be reassigned to proper size in prepareToPlay
-    std::vector<float> sawOutBuff;
-    int corrCounter = 0; //counts up to LARGE_PITCH_ARRAY_SIZE samples, fills buffers and triggers a calc, then resets
-    bool nextCorrBlockReady = false; //set true when the corr is triggered, corr sets false when it is done.
-    bool processingAvg = false; //set high before the processingAvg function is called, set low when done
-    bool coefficientsRdy = false; //say weather or not new coefficients are ready
-    float lastFreqPitch = 1.0; //the previous frequency, this needs to equal current frequency for an actual pitch update to prevent glitching
- 
-    //variables that hold the last state of vol and freq, we only update filters if they actually change
-    float lastFreq= 1.0;
-    float lastFundVol = 0.0;
-    float lastOddVol = 0.0;
-    float lastEvenVol = 0.0;
-    //declare all of the coefficient holding variables
-    juce::dsp::IIR::Coefficients<float>::Ptr fundamentalCoefs;
-    juce::dsp::IIR::Coefficients<float>::Ptr oddOneCoefs;
-    juce::dsp::IIR::Coefficients<float>::Ptr oddTwoCoefs;
-    juce::dsp::IIR::Coefficients<float>::Ptr oddThreeCoefs;
-    juce::dsp::IIR::Coefficients<float>::Ptr oddFourCoefs;
-    juce::dsp::IIR::Coefficients<float>::Ptr evenOneCoefs;
-    juce::dsp::IIR::Coefficients<float>::Ptr evenTwoCoefs;
-    juce::dsp::IIR::Coefficients<float>::Ptr evenThreeCoefs;
-    juce::dsp::IIR::Coefficients<float>::Ptr evenFourCoefs;
+    //the choices on the "harmonicCount" parameter, how many odd and how many even harmonics get a band
+    enum harmonicCount {
+        threeHarmonics,
+        fourHarmonics,
+        eightHarmonics,
+        numHarmonicCounts
+    };
+    static constexpr std::array<int, numHarmonicCounts> harmonicsPerSide{ 3, 4, 8 };
+    //which harmonic bank runs, in the order they appear on the "filterEngine" parameter
+    enum filterEngine {
+        biquadEngine, //coefficients built by the worker and swapped in at block boundaries
+        svfEngine, //state variable bells retuned on the audio thread every SVF_UPDATE_INTERVAL samples
+        numFilterEngines
+    };
+    using bandCoefficients = std::array<float, BIQUAD_COEFFICIENT_COUNT>;
+    static_assert(std::is_same_v<bandCoefficients, PeakCoefficients>, "the cascades read the hand-off as it is");
+    //one band per harmonic, [harmonic - 1], enough for the biggest cascade (smaller ones leave the top alone)
+    using harmonicCoefficients = std::array<bandCoefficients, MAX_BAND_HARMONIC>;
+    //the choices on the "analysisHop" parameter, host samples between pitch estimates (the first is the old non overlapping window)
+    static constexpr std::array<int, 5> analysisHopSizes{ LARGE_PITCH_ARRAY_SIZE, 512, 256, 128, 64 };
+    //analysis windows of lookahead for each choice on the "lookahead" parameter (off, live, render)
+    static constexpr std::array<int, 3> lookaheadWindows{ 0, 1, 2 };
+
+    //the choices on the "synthQuality" parameter, how far the synths and their low pass filters are oversampled
+    enum synthQuality {
+        hostRateSynth, //straight at the host rate, no added latency
+        ecoSynth, //2x, polyphase IIR halfband filters
+        normalSynth, //4x, polyphase IIR halfband filters
+        highSynth, //8x, equiripple FIR halfband filters
+        numSynthQualities
+    };
+    static constexpr std::array<int, numSynthQualities> synthOversamplingFactors{ 1, 2, 4, MAX_SYNTH_OVERSAMPLING };
+
+    //the choices on the "pitchTracking" parameter
+    enum pitchTracking {
+        sharedTracking, //one pitch for the whole bus, from all of the input channels mixed down
+        perChannelTracking, //every input channel follows its own note (a bass DI and a mic, say)
+        numPitchTrackings
+    };
+
+    //the choices on the "pitchSource" parameter
+    enum pitchSource {
+        detectedPitch, //the analysis workers find the note in the input
+        midiPitch, //MIDI notes set the pitch and open the gate, the analysis doesn't run at all
+        midiWithFallbackPitch, //MIDI while a note is held, detection the rest of the time
+        numPitchSources
+    };
+
+    //long lived threads that do the pitch, gate and coefficient work off the audio thread. Each one runs
+    //the lanes whose index lands on it (workerIndex, workerIndex + numWorkers, ...)
+    class AnalysisWorker : public juce::Thread {
+    public:
+        AnalysisWorker(Harmonicator9000AudioProcessor& p, int index)
+            : juce::Thread("Harmonicator9000 Analysis " + juce::String(index)), processor(p), workerIndex(index) {}
+        void run() override;
+        std::counting_semaphore<> wake{ 0 }; //the audio thread releases this once per block this worker has input for
+        std::atomic<bool> busy{ false }; //set around every wake up, so the render thread can tell when it has the lanes to itself
+    private:
+        Harmonicator9000AudioProcessor& processor;
+        int workerIndex;
+    };
+
+    //everything that follows one pitch: the input it hears, its detectors and coefficients, and the filters and
+    //synths that play along with it. Shared tracking runs lane 0 over the whole bus, per channel tracking gives
+    //every input channel a lane of its own. Each group starts on its own cache line, like the processor's below
+    struct AnalysisLane {
+        AnalysisLane(int index);
+
+        const int laneIndex;
+
+        //written by the lane's worker, read by the audio thread and the GUI
+        alignas(CACHE_LINE_SIZE) std::atomic<float> fundamentalFreq{ 100.0f };
+        std::atomic<int> cycleTimeSamples{ 1 }; //period of the current fundamental in whole samples (can never be 0)
+
+        //written by the audio thread, read by the worker: the envelope gate, pitches only count while it is open
+        alignas(CACHE_LINE_SIZE) std::atomic<bool> gateOpen{ false };
+
+        //audio thread -> worker: raw input samples through a wait-free fifo
+        alignas(CACHE_LINE_SIZE) juce::AbstractFifo analysisFifo{ ANALYSIS_FIFO_SIZE };
+        std::array<float, ANALYSIS_FIFO_SIZE> analysisFifoData;
+        //worker -> audio thread: finished coefficients for every band, swapped in at the top of the next block
+        TripleBuffer<harmonicCoefficients> coefficientBuffer;
+
+        //only ever touched by the lane's worker
+        //knob values for the coefficient and pitch work, copied out of the parameter handles each wake up
+        alignas(CACHE_LINE_SIZE) float fundamentalVol = 0.0;
+        float oddHarmVol = 0.0;
+        float evenHarmVol = 0.0;
+        int detectorMode = 0; //which PitchDetectorMode the analysis worker runs
+        int harmonicCount = threeHarmonics; //which cascade the coefficients are built for
+        bool workerBuildsCoefficients = true; //false while the state variable bank tunes itself on the audio thread
+        int analysisHop = LARGE_PITCH_ARRAY_SIZE; //analysis samples between pitch estimates, a whole window means no overlap
+        Decimator analysisDecimator; //host rate input -> analysis rate, in front of the ring
+        int samplesUntilAnalysis = LARGE_PITCH_ARRAY_SIZE; //counts down to the next pitch calc
+        int slidingHop = 0; //hop and detector the sliding sums were built with, so we know when they're stale
+        int slidingDetector = -1;
+        uint32_t ringWritePosition = 0; //total samples written into the ring (wraps, only the low bits matter)
+        float lastFreqPitch = 1.0; //the previous frequency, this needs to equal current frequency for an actual pitch update to prevent glitching
+        //variables that hold the last state of vol and freq, we only update filters if they actually change
+        float lastFreq = 1.0;
+        float lastFundVol = 0.0;
+        float lastOddVol = 0.0;
+        float lastEvenVol = 0.0;
+        int lastHarmonicCount = -1;
+        std::array<float, ANALYSIS_RING_SIZE> analysisRing{}; //the newest decimated input, in arrival order
+        //MAX_ANALYSIS_HOP samples of history and then the window the pitch detectors look at, unwrapped from the ring
+        std::array<float, MAX_ANALYSIS_HOP + LARGE_PITCH_ARRAY_SIZE> largePitchArray{};
+        //one of each detector, made up front so switching modes on the fly never allocates
+        std::array<std::unique_ptr<PitchDetector>, static_cast<size_t>(PitchDetectorMode::numModes)> pitchDetectors;
+        harmonicCoefficients currentCoefs; //the full set as last published, only changed bands get rewritten
+        std::array<int, MAX_BAND_HARMONIC> bandFreqIndex; //table indexes each band was last built from, -1 if never
+        std::array<int, MAX_BAND_HARMONIC> bandGainIndex;
+
+        //only ever touched by the audio thread
+        //the high Q peaking filters for our fundamental frequency and harmonics (as biquads or state variable bells),
+        //every channel of the lane in one pass, one cascade for each harmonicCount so switching never allocates
+        alignas(CACHE_LINE_SIZE) std::array<std::unique_ptr<HarmonicCascade>, numHarmonicCounts> harmonicCascades;
+        //the state variable bank follows this itself, a sub block at a time
+        juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> svfFundamental{ 100.0f };
+        SynthOscillator squareOsc{ OscillatorShape::square }; //the even synth
+        SynthOscillator sawOsc{ OscillatorShape::saw }; //the odd synth
+        //the filters for each of the synth ocillators, one of each for every synthQuality's rate
+        std::array<juce::dsp::LadderFilter<float>, numSynthQualities> oddLowPass;
+        std::array<juce::dsp::LadderFilter<float>, numSynthQualities> evenLowPass;
+        //takes both synths back down to the host rate, one per oversampled synthQuality (none for the host rate)
+        std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, numSynthQualities> synthOversamplers;
+        int activeSynthQuality = -1; //what the synths last rendered at, a switch starts the new filters from silence
+        int synthTailSamples = 0; //host samples still ringing out of the oversampler after both synths went silent, idle at 0
+        //follows the lane's dry input a quantum at a time ahead of the lookahead, it opens the gate and sets the synths' level
+        EnvelopeFollower envelope;
+        float envelopeLevel = 0.0f; //where it got to at the end of the last quantum (linear amplitude)
+        //the synths' gain from the gate (the level while open, 0 while shut) held back by the lookahead, so the synths
+        //open and close with the delayed audio they play under
+        LookaheadDelay gateGainDelay;
+        float delayedGateGain = 0.0f; //what came out of it at the end of the last quantum
+        //MIDI pitch: the notes held on this lane's channel, oldest first
+        struct HeldNote {
+            int noteNumber = 0;
+            float velocity = 0.0f;
+        };
+        std::array<HeldNote, MIDI_NOTE_STACK_SIZE> heldNotes;
+        int numHeldNotes = 0;
+        float midiFreq = 0.0f; //the newest held note folded into our range, kept after the release in MIDI mode
+        //coefficients for the held note, built right here rather than by the worker
+        harmonicCoefficients midiCoefs;
+        std::array<int, MAX_BAND_HARMONIC> midiBandFreqIndex;
+        std::array<int, MAX_BAND_HARMONIC> midiBandGainIndex;
+        int emittedNote = -1; //the detected note last sent out as MIDI, -1 for none
+        int emittedChannel = 1; //and the channel it went out on, its note off goes there too
+    };
+
+    //==============================================================================
+    //everything below is per instance, grouped by the thread that writes it, and each group starts on
+    //its own cache line so the workers and the audio thread (and neighbouring instances) don't fight over lines
+
+    //the apvts' own atomics for every parameter, looked up by id once in the constructor so nothing
+    //after that hashes a string, every thread loads straight from these
+    struct ParameterHandles {
+        std::atomic<float>* oddLowPass = nullptr;
+        std::atomic<float>* oddSynth = nullptr;
+        std::atomic<float>* oddHarmonics = nullptr;
+        std::atomic<float>* fundamental = nullptr;
+        std::atomic<float>* evenHarmonics = nullptr;
+        std::atomic<float>* evenSynth = nullptr;
+        std::atomic<float>* evenLowPass = nullptr;
+        std::atomic<float>* pitchDetector = nullptr;
+        std::atomic<float>* analysisHop = nullptr;
+        std::atomic<float>* oscillatorMode = nullptr;
+        std::atomic<float>* lookahead = nullptr;
+        std::atomic<float>* filterEngine = nullptr;
+        std::atomic<float>* pitchTracking = nullptr;
+        std::atomic<float>* synthQuality = nullptr;
+        std::atomic<float>* harmonicCount = nullptr;
+        std::atomic<float>* pitchSource = nullptr;
+        std::atomic<float>* midiOut = nullptr;
+        std::atomic<float>* gateThreshold = nullptr;
+        std::atomic<float>* gateHysteresis = nullptr;
+        std::atomic<float>* gateAttack = nullptr;
+        std::atomic<float>* gateRelease = nullptr;
+        std::atomic<float>* gateDetector = nullptr;
+    };
+    alignas(CACHE_LINE_SIZE) ParameterHandles params;
+
+    //only changed in prepareToPlay while the workers are stopped, read by everyone
+    //lanes are made as the bus grows and never freed before the processor, so the GUI can always read lane 0
+    std::array<std::unique_ptr<AnalysisLane>, MAX_CHANNELS> lanes;
+    std::array<std::unique_ptr<AnalysisWorker>, MAX_ANALYSIS_WORKERS> analysisWorkers;
+    int numLanes = 1; //one per input channel (at least one), the most per channel tracking can use
+    int numWorkers = 1; //threads the lanes are spread over
+    int analysisFactor = 1; //host samples per analysis sample
+    int analysisWindowSize = LARGE_PITCH_ARRAY_SIZE; //pitch window in analysis samples, picked from the rate in prepareToPlay
+    //peak coefficients by quantized fundamental and gain, so retuning is a lookup instead of a makePeakFilter
+    PeakCoefficientTable peakTable;
+    bandCoefficients allPassCoefs; //what a band sits at when it is off or past nyquist
+    std::array<int, numSynthQualities> synthLatencies{}; //host samples each synthQuality's oversampling holds the synths back
+
+    //only ever touched by the audio thread
+    //knob values for this block, snapshotted at the top of processBlock and smoothed from block to block
+    alignas(CACHE_LINE_SIZE) juce::SmoothedValue<float> evenSynthLevel; //linear gain, 0 when the knob is at -100
+    juce::SmoothedValue<float> oddSynthLevel;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> evenLP{ 20000.0f }; //multiplicative can't start from 0
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> oddLP{ 20000.0f };
+    int oscillatorMode = 0; //which OscillatorMode the synths render with
+    int synthQuality = hostRateSynth; //which synthQuality the synths render at
+    std::vector<float> squareOutBuff; //these will be reassigned to proper size in prepareToPlay, one quantum long
+    std::vector<float> sawOutBuff; //room for a quantum at the highest oversampled rate
+    std::vector<float> analysisMixBuff; //the input channels mixed down for shared tracking, a quantum at a time
+    std::vector<float> gateGainBuff; //a lane's gate gain on its way through the lookahead, a quantum at a time
+    int lookaheadMode = 0; //which lookaheadWindows entry the block runs at, the knob's or Off when MIDI sets the pitch
+    int filterEngine = biquadEngine; //the bank this block runs through
+    int activeFilterEngine = -1; //the bank the last block ran through, a switch starts the new one from silence
+    int harmonicCount = threeHarmonics; //the cascade this block runs through
+    int activeHarmonicCount = -1; //and the one the last block ran through
+    int pitchSource = detectedPitch; //where this block's pitch comes from
+    int activePitchSource = detectedPitch; //and where the last block's did, a switch hands the filters to the other side
+    bool midiOut = false; //send the detected notes out as MIDI
+    juce::MidiBuffer midiOutBuff; //the notes we send this block, reserved in prepareToPlay and never handed to the host
+    juce::MidiBuffer midiThroughBuff; //what came in that isn't a note, kept while the notes are taken out
+    float gateOpenLevel = 0.0f; //the envelope opens the gate above this and closes it below the other (linear)
+    float gateCloseLevel = 0.0f;
+    int numActiveLanes = 1; //lanes this block feeds and plays, 1 for shared tracking
+    int activeNumLanes = 0; //what the last block ran with, a change starts every bank from silence
+    //the state variable bank's band gains, shared by every lane
+    juce::SmoothedValue<float> svfFundamentalDb;
+    juce::SmoothedValue<float> svfOddDb;
+    juce::SmoothedValue<float> svfEvenDb;
+    int lookaheadWindowSamples = 0; //one analysis window in host samples, set in prepareToPlay
+    //rendering offline the render thread runs the analysis itself, through this rather than the workers
+    OfflinePitchAnalysis offlineAnalysis;
+    int offlineWindowSize = LARGE_PITCH_ARRAY_SIZE; //offline pitch window in analysis samples, set in prepareToPlay
+    LookaheadDelay lookahead; //holds the audio path back while the analysis works out the note (and the synths are oversampled)
+    std::atomic<int> reportedLatency{ 0 }; //the delay the host should be told about, the first worker passes changes on
+    bool analysingOffline = false; //which path the lanes' analysis state was last set up for
+    std::atomic<bool> workersHeld{ false }; //the render thread has the lanes, the workers skip their passes until it lets go
+
+    //only ever touched by the first analysis worker
+    alignas(CACHE_LINE_SIZE) int notifiedLatency = 0; //the last latency we asked the message thread to report
+
+    //audio thread and workers -> anyone: timings and counts, each side writes its own counters
+    //(the pitch and coefficient ones follow lane 0, so they keep a single writer)
+    PerformanceMetrics metrics;
+    //audio thread -> the editor's analyzer, only carries anything while the editor is open
+    AnalyzerFifo analyzerFifo;
+
     double sampleRate = 48000; //default sample rate, change in process audio block
-    //function to add sample to fft
-    void addToCorr(float sample) noexcept;
-    //compute fft then find the fundamental(this should be spawned in a thread or fork)
-    void getFundamentalFrequency() noexcept;
-    //update the average
-    void updateAvg() noexcept;
-    //function to get the next square wave sample
-    void getNextSquare() noexcept;
-    //function to get the next saw wave sample
-    void getNextSaw() noexcept;
-    //function to update filter coefficients
-    void updateFilters() noexcept;
-
-    //declare the filters for each of our synth ocillators 
-    juce::dsp::LadderFilter<float> oddLowPass;
-    juce::dsp::LadderFilter<float> evenLowPass;
-
-    //declare all of the filters for our fundamental frequency and harmonics (high Q peaking filters, stereo)
-    juce::dsp::IIR::Filter<float> fundamentalBandL;
-    juce::dsp::IIR::Filter<float> firstOddBandL;
-    juce::dsp::IIR::Filter<float> secondOddBandL;
-    juce::dsp::IIR::Filter<float> thirdOddBandL;
-    juce::dsp::IIR::Filter<float> fourthOddBandL;
-    juce::dsp::IIR::Filter<float> firstEvenBandL;
-    juce::dsp::IIR::Filter<float> secondEvenBandL;
-    juce::dsp::IIR::Filter<float> thirdEvenBandL;
-    juce::dsp::IIR::Filter<float> fourthEvenBandL;
-
-    juce::dsp::IIR::Filter<float> fundamentalBandR;
-    juce::dsp::IIR::Filter<float> firstOddBandR;
-    juce::dsp::IIR::Filter<float> secondOddBandR;
-    juce::dsp::IIR::Filter<float> thirdOddBandR;
-    juce::dsp::IIR::Filter<float> fourthOddBandR;
-    juce::dsp::IIR::Filter<float> firstEvenBandR;
-    juce::dsp::IIR::Filter<float> secondEvenBandR;
-    juce::dsp::IIR::Filter<float> thirdEvenBandR;
-    juce::dsp::IIR::Filter<float> fourthEvenBandR;
+    //the channels a lane plays into, the whole bus when one lane follows it all (audio thread)
+    juce::dsp::AudioBlock<float> getLaneBlock(const juce::dsp::AudioBlock<float>& block, int lane) const noexcept;
+    //push a block of input into a lane's fifo, returns how many samples fit (audio thread)
+    int pushToAnalysis(AnalysisLane& lane, const float* samples, int numSamples) noexcept;
+    //hand a block to a lane, offline this runs the precise analysis right away instead (audio thread)
+    void feedAnalysis(AnalysisLane& lane, const float* samples, int numSamples);
+    //offline: a window every OFFLINE_ANALYSIS_HOP, detected in batches across every core before this returns (render thread)
+    void runOfflineAnalysis(AnalysisLane& lane, const float* samples, int numSamples);
+    //hand the lanes between the workers and the render thread when the host starts or stops rendering offline (audio thread)
+    void switchAnalysisPath(bool offline) noexcept;
+    //empty a lane's fifo, decimator and ring, the first estimate comes once windowSize samples are in
+    void resetLaneAnalysis(AnalysisLane& lane, int windowSize) noexcept;
+    //take the pitches out of a finished offline batch in order, then empty it (render thread)
+    void applyOfflineBatch(AnalysisLane& lane);
+    //one wake up of a worker, runs every lane it owns (worker thread)
+    void runWorkerPass(int workerIndex) noexcept;
+    //drain a lane's fifo, run the pitch/gate analysis and rebuild coefficients if needed (worker thread)
+    void runAnalysis(AnalysisLane& lane) noexcept;
+    //ask the message thread to report the lookahead if it moved (first worker, or the render thread offline)
+    void passOnLatency() noexcept;
+    //copy the knob values the worker needs out of the parameter handles (worker thread)
+    void getUserDefinedSettings(AnalysisLane& lane) noexcept;
+    //snapshot the knob values the audio thread needs and point the smoothers at them (audio thread)
+    void updateBlockParameters() noexcept;
+    //size a lane's detectors, filters and synths for the current rate and start it from silence (message thread)
+    void prepareLane(AnalysisLane& lane, const juce::dsp::ProcessSpec& spec, int numChannels);
+    //start and stop the workers around prepareToPlay/releaseResources
+    void startAnalysis();
+    void stopAnalysis();
+    //add a sample to the ring and run the pitch and volume calcs every hop
+    void addToCorr(AnalysisLane& lane, float sample) noexcept;
+    //run the selected pitch detector on the window then decide if the fundamental moved
+    void getFundamentalFrequency(AnalysisLane& lane) noexcept;
+    //decide if a detected period (host samples) is a new note, and take it if it is
+    void acceptPeriod(AnalysisLane& lane, float period) noexcept;
+    //rebuild the coefficients if the pitch or any knob they depend on moved (unless the audio thread tunes its own)
+    void updateFiltersIfChanged(AnalysisLane& lane) noexcept;
+    //host samples of delay for a lookahead choice
+    int getLookaheadSamples(int mode) const noexcept;
+    //everything the dry path is held back by, the lookahead plus the synth oversampling so the synths stay lined up
+    int getAudioDelaySamples(int mode, int quality) const noexcept;
+    //tell the host about a new lookahead (message thread)
+    void handleAsyncUpdate() override;
+    //look up coefficients for the bands whose pitch or gain moved (worker thread, publishes through the lane's coefficientBuffer)
+    void updateFilters(AnalysisLane& lane) noexcept;
+    //copy the latest published coefficients into a lane's filters (audio thread)
+    void applyCoefficients(AnalysisLane& lane, const harmonicCoefficients& newCoefs) noexcept;
+    //quantize a pitch and the band gains to the table and rebuild the bands of a harmonic count that moved,
+    //returns true if any did (worker for its own set, audio thread for the MIDI one)
+    bool buildCoefficients(float fundamental, float fundVol, float oddVol, float evenVol, int count, harmonicCoefficients& coefs,
+        std::array<int, MAX_BAND_HARMONIC>& freqIndexes, std::array<int, MAX_BAND_HARMONIC>& gainIndexes) const noexcept;
+    //true if a held MIDI note is steering the lane right now (audio thread)
+    bool isMidiSteered(const AnalysisLane& lane) const noexcept;
+    //the pitch the lane plays and filters at, the newest held note or the detected one (audio thread)
+    float getLanePitch(const AnalysisLane& lane) const noexcept;
+    //put whichever coefficients are steering the lane into its filters, the held note's rebuilt for the current knobs
+    //or the worker's latest (audio thread)
+    void applyLaneCoefficients(AnalysisLane& lane) noexcept;
+    //note on/off and all notes off onto the held notes of the lane for that channel, retuning it if it moved (audio thread)
+    void handleMidiEvent(const juce::MidiMessage& message) noexcept;
+    //the synths and harmonic bands for one quantum of a block (up to PROCESS_QUANTUM samples), everything in it
+    //at one pitch per lane (audio thread)
+    void renderQuantum(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, bool& gateWasOpen) noexcept;
+    //note offs and ons at the top of the block wherever a lane's detected note changed (audio thread)
+    void emitDetectedNotes(juce::MidiBuffer& midiMessages) noexcept;
+    //run every channel of a block through its lane's harmonic peak filter cascade (audio thread)
+    void processHarmonicBands(juce::dsp::AudioBlock<float>& block) noexcept;
+    //the same through the state variable banks, retuning them from the smoothed pitch and knobs as they go (audio thread)
+    void processSvfBands(juce::dsp::AudioBlock<float>& block) noexcept;
+
+    //the benchmark console app (../Benchmarks) times the private stages on their own
+    friend struct ProcessorBenchmarkAccess;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Harmonicator9000AudioProcessor)
 };
@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafety.h"
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if HARMONICATOR_RT_CHECKS && defined(__GLIBC__)
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #define RT_SAFETY_GLIBC_HOOKS 1
+#else
+ #define RT_SAFETY_GLIBC_HOOKS 0
+#endif
+
+#if defined(_MSC_VER)
+ #include <intrin.h>
+ #define RT_SAFETY_CALLER _ReturnAddress()
+#else
+ #define RT_SAFETY_CALLER __builtin_return_address(0)
+#endif
+
+//==============================================================================
+//everything in here can run from inside malloc, so none of it allocates, locks or needs a static initializer
+namespace {
+    struct SiteCount {
+        std::atomic<bool> claimed{ false };
+        std::atomic<bool> ready{ false }; //kind, site and caller are filled in
+        RealtimeSafety::Violation kind = RealtimeSafety::Violation::allocation;
+        const char* site = nullptr;
+        const void* caller = nullptr;
+        std::atomic<int> count{ 0 };
+    };
+
+    SiteCount siteCounts[RT_SAFETY_MAX_SITES];
+    std::atomic<int> totalViolations{ 0 };
+
+    thread_local bool insideCallback = false;
+    thread_local bool insideHook = false; //so the bookkeeping can't trip over itself
+    thread_local const char* currentSite = nullptr;
+
+    const char* const violationNames[] = { "allocation", "deallocation", "lock", "thread creation" };
+}
+
+//==============================================================================
+RealtimeSafety::ScopedAudioCallback::ScopedAudioCallback(bool armed) noexcept : wasInside(insideCallback) {
+    insideCallback = insideCallback || armed;
+}
+
+RealtimeSafety::ScopedAudioCallback::~ScopedAudioCallback() noexcept {
+    insideCallback = wasInside;
+}
+
+RealtimeSafety::ScopedSite::ScopedSite(const char* name) noexcept : previous(currentSite) {
+    currentSite = name;
+}
+
+RealtimeSafety::ScopedSite::~ScopedSite() noexcept {
+    currentSite = previous;
+}
+
+void RealtimeSafety::noteViolation(Violation kind, const void* caller) noexcept {
+    if (!insideCallback || insideHook) {
+        return;
+    }
+    insideHook = true;
+    totalViolations++;
+    const char* site = currentSite != nullptr ? currentSite : "processBlock";
+    for (auto& entry : siteCounts) {
+        if (entry.ready.load(std::memory_order_acquire)) {
+            if (entry.kind == kind && entry.site == site && entry.caller == caller) {
+                entry.count++;
+                break;
+            }
+        }
+        else if (!entry.claimed.exchange(true)) {
+            entry.kind = kind;
+            entry.site = site;
+            entry.caller = caller;
+            entry.count = 1;
+            entry.ready.store(true, std::memory_order_release);
+            break;
+        }
+        //claimed by another thread that hasn't finished filling it in, keep looking (if the table fills up
+        //the violation still shows in the total)
+    }
+    insideHook = false;
+}
+
+int RealtimeSafety::getNumViolations() noexcept {
+    return totalViolations.load();
+}
+
+juce::String RealtimeSafety::getReport() {
+    juce::String report;
+    int listed = 0;
+    for (auto& entry : siteCounts) {
+        if (entry.ready.load(std::memory_order_acquire)) {
+            report << violationNames[static_cast<int>(entry.kind)] << " in " << entry.site << " from 0x"
+                << juce::String::toHexString(static_cast<juce::pointer_sized_int>(reinterpret_cast<juce::pointer_sized_uint>(entry.caller)))
+                << ": " << entry.count.load() << "\n";
+            listed += entry.count.load();
+        }
+    }
+    if (listed < totalViolations.load()) {
+        report << (totalViolations.load() - listed) << " more after the site table filled up\n";
+    }
+    return report;
+}
+
+void RealtimeSafety::reset() noexcept {
+    for (auto& entry : siteCounts) {
+        entry.ready = false;
+        entry.count = 0;
+        entry.claimed = false;
+    }
+    totalViolations = 0;
+}
+
+//==============================================================================
+//the hooks themselves, only built for the harness
+#if HARMONICATOR_RT_CHECKS
+
+#if RT_SAFETY_GLIBC_HOOKS
+//glibc's real allocator, underneath the malloc we replace below
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+extern "C" void* __libc_memalign(size_t, size_t);
+extern "C" void __libc_free(void*);
+#endif
+
+static void* rawAllocate(size_t size) noexcept {
+   #if RT_SAFETY_GLIBC_HOOKS
+    return __libc_malloc(size);
+   #else
+    return std::malloc(size);
+   #endif
+}
+
+static void rawFree(void* pointer) noexcept {
+   #if RT_SAFETY_GLIBC_HOOKS
+    __libc_free(pointer);
+   #else
+    std::free(pointer);
+   #endif
+}
+
+static void* rawAllocateAligned(size_t size, size_t alignment) noexcept {
+   #if RT_SAFETY_GLIBC_HOOKS
+    return __libc_memalign(alignment, size);
+   #elif defined(_MSC_VER)
+    return _aligned_malloc(size, alignment);
+   #else
+    void* pointer = nullptr;
+    return posix_memalign(&pointer, juce::jmax(alignment, sizeof(void*)), size) == 0 ? pointer : nullptr;
+   #endif
+}
+
+static void rawFreeAligned(void* pointer) noexcept {
+   #if defined(_MSC_VER)
+    _aligned_free(pointer);
+   #else
+    rawFree(pointer);
+   #endif
+}
+
+//the plain and aligned forms, the nothrow, array and sized forms all come through these
+void* operator new(size_t size) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::allocation, RT_SAFETY_CALLER);
+    if (void* pointer = rawAllocate(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    if (pointer != nullptr) {
+        RealtimeSafety::noteViolation(RealtimeSafety::Violation::deallocation, RT_SAFETY_CALLER);
+        rawFree(pointer);
+    }
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::allocation, RT_SAFETY_CALLER);
+    if (void* pointer = rawAllocateAligned(size == 0 ? 1 : size, static_cast<size_t>(alignment))) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    if (pointer != nullptr) {
+        RealtimeSafety::noteViolation(RealtimeSafety::Violation::deallocation, RT_SAFETY_CALLER);
+        rawFreeAligned(pointer);
+    }
+}
+
+#if RT_SAFETY_GLIBC_HOOKS
+//glibc lets an executable replace malloc outright, and std::mutex, juce::CriticalSection and std::thread all
+//go through the pthread calls, so on Linux we catch C allocations, locks and thread creation as well
+extern "C" {
+void* malloc(size_t size) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::allocation, RT_SAFETY_CALLER);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::allocation, RT_SAFETY_CALLER);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::allocation, RT_SAFETY_CALLER);
+    return __libc_realloc(pointer, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::allocation, RT_SAFETY_CALLER);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::allocation, RT_SAFETY_CALLER);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::allocation, RT_SAFETY_CALLER);
+    *result = __libc_memalign(alignment, size);
+    return *result != nullptr ? 0 : ENOMEM;
+}
+
+void free(void* pointer) {
+    if (pointer != nullptr) {
+        RealtimeSafety::noteViolation(RealtimeSafety::Violation::deallocation, RT_SAFETY_CALLER);
+        __libc_free(pointer);
+    }
+}
+
+//the real ones are looked up once while the library loads, before anything can be inside a callback. dlsym
+//can lock and allocate itself, so it never runs from inside a hook. Plain atomics rather than function statics
+//because a static's guard can take a lock itself
+using MutexLockFunction = int (*)(pthread_mutex_t*);
+using ThreadCreateFunction = int (*)(pthread_t*, const pthread_attr_t*, void* (*)(void*), void*);
+static std::atomic<MutexLockFunction> realMutexLock{ nullptr };
+static std::atomic<ThreadCreateFunction> realThreadCreate{ nullptr };
+
+__attribute__((constructor(101))) static void resolveRealFunctions() {
+    realMutexLock.store(reinterpret_cast<MutexLockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock")), std::memory_order_release);
+    realThreadCreate.store(reinterpret_cast<ThreadCreateFunction>(dlsym(RTLD_NEXT, "pthread_create")), std::memory_order_release);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::lock, RT_SAFETY_CALLER);
+    auto function = realMutexLock.load(std::memory_order_acquire);
+    if (function != nullptr) {
+        return function(mutex);
+    }
+    //another library's constructor can lock before ours has run, trylock isn't hooked so spin on that until then
+    int result;
+    while ((result = pthread_mutex_trylock(mutex)) == EBUSY) {
+        sched_yield();
+    }
+    return result;
+}
+
+int pthread_create(pthread_t* thread, const pthread_attr_t* attributes, void* (*start)(void*), void* argument) {
+    RealtimeSafety::noteViolation(RealtimeSafety::Violation::threadCreation, RT_SAFETY_CALLER);
+    auto function = realThreadCreate.load(std::memory_order_acquire);
+    //there is no other way in before our constructor has run, fail the way pthread_create is allowed to
+    return function != nullptr ? function(thread, attributes, start, argument) : EAGAIN;
+}
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.h
+
+    Debug/test instrumentation for the audio callback. Built with
+    HARMONICATOR_RT_CHECKS=1 it replaces the global operator new/delete and,
+    on glibc, malloc/free, pthread_mutex_lock and pthread_create, and any of
+    those that happen on a thread while it is inside the audio callback get
+    counted against the callback stage it was in (RT_SAFETY_SITE) and the
+    address it was called from. The test harness checks the count and fails
+    on anything but zero.
+
+    The hooks replace symbols for the whole process, so only turn this on in
+    executables we own (the benchmark app), never in the plugin a host loads.
+    Without the define the macros compile away to nothing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef HARMONICATOR_RT_CHECKS
+ #define HARMONICATOR_RT_CHECKS 0
+#endif
+
+#define RT_SAFETY_MAX_SITES 64 //distinct (kind, site, caller) combinations we keep counts for
+
+namespace RealtimeSafety {
+    enum class Violation {
+        allocation,
+        deallocation,
+        lock,
+        threadCreation,
+        numKinds
+    };
+
+    //true when the hooks are compiled in
+    constexpr bool isEnabled() noexcept { return HARMONICATOR_RT_CHECKS != 0; }
+
+    //marks this thread as inside the audio callback until it goes out of scope, pass false to leave it unarmed
+    //(an offline render has no deadline to break)
+    class ScopedAudioCallback {
+    public:
+        explicit ScopedAudioCallback(bool armed = true) noexcept;
+        ~ScopedAudioCallback() noexcept;
+    private:
+        bool wasInside;
+    };
+
+    //names the stage of the callback we're in, violations get tagged with the innermost one
+    class ScopedSite {
+    public:
+        explicit ScopedSite(const char* name) noexcept;
+        ~ScopedSite() noexcept;
+    private:
+        const char* previous;
+    };
+
+    //count a violation if this thread is inside the callback (the hooks call this, anything else can too)
+    void noteViolation(Violation kind, const void* caller) noexcept;
+    int getNumViolations() noexcept;
+    //one line per site with its count, for printing once the audio has stopped (allocates)
+    juce::String getReport();
+    void reset() noexcept;
+}
+
+#if HARMONICATOR_RT_CHECKS
+ #define RT_SAFETY_CALLBACK(armed) RealtimeSafety::ScopedAudioCallback rtSafetyCallback (armed)
+ #define RT_SAFETY_SITE(name) RealtimeSafety::ScopedSite JUCE_JOIN_MACRO (rtSafetySite, __LINE__) (name)
+#else
+ #define RT_SAFETY_CALLBACK(armed)
+ #define RT_SAFETY_SITE(name)
+#endif
@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyzer.h"
+#include "PluginEditor.h"
+
+SpectrumAnalyzer::SpectrumAnalyzer(Harmonicator9000AudioProcessor& p) : audioProcessor(p) {
+    for (auto& s : streams) {
+        s.levels.fill(ANALYZER_MIN_DB);
+    }
+    setOpaque(true);
+    //from here on the audio thread copies its blocks over for us
+    audioProcessor.getAnalyzerFifo().setActive(true);
+    startTimerHz(ANALYZER_FRAME_RATE);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    stopTimer();
+    //nobody is reading any more, the audio thread's pushes go back to doing nothing
+    audioProcessor.getAnalyzerFifo().setActive(false);
+}
+
+//==============================================================================
+void SpectrumAnalyzer::timerCallback() {
+    const float fundamental = audioProcessor.getFundamentalFreq();
+    const int harmonics = audioProcessor.getHarmonicsPerSide();
+    bool changed = fundamental != shownFundamental || harmonics != shownHarmonics;
+    shownFundamental = fundamental;
+    shownHarmonics = harmonics;
+
+    for (int streamIndex = 0; streamIndex < AnalyzerFifo::numStreams; ++streamIndex) {
+        if (pullStream(streamIndex)) {
+            analyseStream(streamIndex);
+            buildPath(streamIndex);
+            changed = true;
+        }
+    }
+    //nothing playing and the pitch sitting still costs no painting at all
+    if (changed) {
+        repaint();
+    }
+}
+
+bool SpectrumAnalyzer::pullStream(int streamIndex) {
+    auto& s = streams[streamIndex];
+    bool pulled = false;
+    //the ring takes at most up to its end each time round
+    while (true) {
+        const int numPulled = audioProcessor.getAnalyzerFifo().pull(streamIndex, s.history.data() + s.writePosition,
+            ANALYZER_FFT_SIZE - s.writePosition);
+        if (numPulled == 0) {
+            return pulled;
+        }
+        s.writePosition = (s.writePosition + numPulled) & (ANALYZER_FFT_SIZE - 1);
+        pulled = true;
+    }
+}
+
+void SpectrumAnalyzer::analyseStream(int streamIndex) {
+    auto& s = streams[streamIndex];
+    //unwrap the ring oldest first, then window and transform it
+    std::copy(s.history.begin() + s.writePosition, s.history.end(), fftData.begin());
+    std::copy(s.history.begin(), s.history.begin() + s.writePosition, fftData.begin() + (ANALYZER_FFT_SIZE - s.writePosition));
+    window.multiplyWithWindowingTable(fftData.data(), ANALYZER_FFT_SIZE);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    //a full scale sine through a hann window comes out at N / 4, scale so that reads 0 dB
+    const float scale = 4.0f / static_cast<float>(ANALYZER_FFT_SIZE);
+    for (int bin = 0; bin < ANALYZER_FFT_SIZE / 2; ++bin) {
+        const float db = juce::Decibels::gainToDecibels(fftData[bin] * scale, ANALYZER_MIN_DB);
+        s.levels[bin] = juce::jmax(db, s.levels[bin] - ANALYZER_DECAY_DB);
+    }
+}
+
+void SpectrumAnalyzer::buildPath(int streamIndex) {
+    auto& s = streams[streamIndex];
+    s.path.clear();
+    const int width = getWidth();
+    if (width <= 0) {
+        return;
+    }
+    const float binsPerHz = static_cast<float>(ANALYZER_FFT_SIZE / getSampleRate());
+    const float freqRatio = ANALYZER_MAX_FREQ / ANALYZER_MIN_FREQ;
+    for (int x = 0; x < width; x += ANALYZER_PIXELS_PER_POINT) {
+        //the bins between this point and the next, always at least one
+        const float lowFreq = ANALYZER_MIN_FREQ * std::pow(freqRatio, static_cast<float>(x) / width);
+        const float highFreq = ANALYZER_MIN_FREQ * std::pow(freqRatio, static_cast<float>(x + ANALYZER_PIXELS_PER_POINT) / width);
+        const int lowBin = juce::jlimit(0, ANALYZER_FFT_SIZE / 2 - 1, juce::roundToInt(lowFreq * binsPerHz));
+        const int highBin = juce::jlimit(lowBin, ANALYZER_FFT_SIZE / 2 - 1, juce::roundToInt(highFreq * binsPerHz));
+        float loudest = s.levels[lowBin];
+        for (int bin = lowBin + 1; bin <= highBin; ++bin) {
+            loudest = juce::jmax(loudest, s.levels[bin]);
+        }
+        const float y = levelToY(loudest);
+        if (x == 0) {
+            s.path.startNewSubPath(0.0f, y);
+        }
+        else {
+            s.path.lineTo(static_cast<float>(x), y);
+        }
+    }
+}
+
+//==============================================================================
+void SpectrumAnalyzer::paint(juce::Graphics& g) {
+    g.fillAll(BACKGROUND_COLOR);
+
+    //a marker on the fundamental and each harmonic band, coloured like the knob that sets it
+    if (shownFundamental > 0.0f) {
+        for (int band = 0; band < 1 + 2 * shownHarmonics; ++band) {
+            const int harmonic = getBandHarmonic(band, shownHarmonics);
+            const float freq = shownFundamental * static_cast<float>(harmonic);
+            if (freq > ANALYZER_MAX_FREQ) {
+                continue;
+            }
+            g.setColour((harmonic == 1 ? FUNDAMEMTAL_VOL_COLOR : (harmonic % 2 == 1 ? ODD_VOL_COLOR : EVEN_VOL_COLOR)).withAlpha(0.7f));
+            g.drawVerticalLine(juce::roundToInt(frequencyToX(freq)), 0.0f, static_cast<float>(getHeight()));
+        }
+    }
+
+    //input underneath in grey, what we send out on top
+    g.setColour(juce::Colours::grey);
+    g.strokePath(streams[AnalyzerFifo::inputStream].path, juce::PathStrokeType(1.0f));
+    g.setColour(TEXT_COLOR);
+    g.strokePath(streams[AnalyzerFifo::outputStream].path, juce::PathStrokeType(1.0f));
+
+    g.setColour(TEXT_COLOR);
+    g.setFont(juce::Font(TEXT_HEIGHT_VALUE_LABELS));
+    g.drawText(shownFundamental > 0.0f ? juce::String(shownFundamental, 1) + " Hz" : juce::String("--"),
+        getLocalBounds().reduced(4), juce::Justification::topLeft);
+}
+
+void SpectrumAnalyzer::resized() {
+    //the paths are traced in pixels, trace them again for the new width
+    for (int streamIndex = 0; streamIndex < AnalyzerFifo::numStreams; ++streamIndex) {
+        buildPath(streamIndex);
+    }
+}
+
+float SpectrumAnalyzer::frequencyToX(float freq) const noexcept {
+    return getWidth() * std::log(freq / ANALYZER_MIN_FREQ) / std::log(ANALYZER_MAX_FREQ / ANALYZER_MIN_FREQ);
+}
+
+float SpectrumAnalyzer::levelToY(float db) const noexcept {
+    return juce::jmap(juce::jlimit(ANALYZER_MIN_DB, ANALYZER_MAX_DB, db), ANALYZER_MAX_DB, ANALYZER_MIN_DB, 0.0f, static_cast<float>(getHeight()));
+}
+
+double SpectrumAnalyzer::getSampleRate() const noexcept {
+    //before the host has prepared us there is no rate, any sensible one does for an empty plot
+    const double rate = audioProcessor.getSampleRate();
+    return rate > 0.0 ? rate : 44100.0;
+}
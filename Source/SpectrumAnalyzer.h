@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.h
+
+    The editor's analyzer: the input and output spectrum on a log frequency
+    axis, with a marker on the detected fundamental and on every harmonic
+    band's centre. It drains the processor's AnalyzerFifo on the message
+    thread, at most ANALYZER_FRAME_RATE times a second, and only repaints
+    when something new came in. The feed is switched on while the analyzer
+    exists and off again when the editor closes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#define ANALYZER_FFT_ORDER 12 //4096 point transform, about 11 Hz a bin at 44.1k
+#define ANALYZER_FFT_SIZE (1 << ANALYZER_FFT_ORDER)
+#define ANALYZER_FRAME_RATE 30 //most frames a second the analyzer pulls, transforms and repaints
+#define ANALYZER_MIN_FREQ 20.0f //left and right edges of the plot
+#define ANALYZER_MAX_FREQ 20000.0f
+#define ANALYZER_MIN_DB -90.0f //bottom and top of the plot
+#define ANALYZER_MAX_DB 6.0f
+#define ANALYZER_DECAY_DB 3.0f //how far a peak falls each frame once the signal under it has gone
+#define ANALYZER_PIXELS_PER_POINT 2 //the paths get one point every this many pixels across
+
+class SpectrumAnalyzer : public juce::Component,
+                         private juce::Timer {
+public:
+    SpectrumAnalyzer(Harmonicator9000AudioProcessor& p);
+    ~SpectrumAnalyzer() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    //move whatever the audio thread has sent of one stream into its history, true if anything came
+    bool pullStream(int streamIndex);
+    //window and transform the newest ANALYZER_FFT_SIZE samples of a stream into peak held levels per bin
+    void analyseStream(int streamIndex);
+    //trace a stream's levels with the loudest bin under every few pixels, so the path stays the same size
+    //however many bins there are
+    void buildPath(int streamIndex);
+    float frequencyToX(float freq) const noexcept;
+    float levelToY(float db) const noexcept;
+    double getSampleRate() const noexcept;
+
+    Harmonicator9000AudioProcessor& audioProcessor;
+    juce::dsp::FFT fft{ ANALYZER_FFT_ORDER };
+    juce::dsp::WindowingFunction<float> window{ ANALYZER_FFT_SIZE, juce::dsp::WindowingFunction<float>::hann };
+    std::array<float, 2 * ANALYZER_FFT_SIZE> fftData{}; //the transform works in place and wants twice the room
+
+    struct StreamView {
+        std::array<float, ANALYZER_FFT_SIZE> history{}; //newest samples, a ring
+        int writePosition = 0;
+        std::array<float, ANALYZER_FFT_SIZE / 2> levels; //dB per bin, falling by ANALYZER_DECAY_DB a frame
+        juce::Path path;
+    };
+    std::array<StreamView, AnalyzerFifo::numStreams> streams;
+
+    float shownFundamental = 0.0f; //the markers as they were last painted
+    int shownHarmonics = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyzer)
+};
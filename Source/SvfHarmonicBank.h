@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    SvfHarmonicBank.h
+
+    The harmonic peaks as a cascade of numSections bell filters built on the
+    topology preserving (trapezoidal) state variable filter. The bell has
+    the same response as juce's makePeakFilter, but its state is the two
+    integrator memories rather than a biquad's mixed history, so the
+    coefficients can be changed every few samples (following a glide, a
+    knob) without the zipper noise or blow ups a Q=10 biquad gets when its
+    coefficients jump. Channels ride in SIMDRegister lanes exactly like
+    HarmonicFilterBank.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "HarmonicFilterBank.h" //unrolled()
+
+template <int numSections>
+class SvfHarmonicBank
+{
+public:
+    using Register = juce::dsp::SIMDRegister<float>;
+    static constexpr int lanes = static_cast<int>(Register::SIMDNumElements);
+
+    //size the state for this many channels, every section starts out flat (allocates)
+    void prepare(double newSampleRate, int newNumChannels) {
+        sampleRate = newSampleRate;
+        numChannels = juce::jmax(1, newNumChannels);
+        const int numGroups = (numChannels + lanes - 1) / lanes;
+        state.assign(static_cast<size_t>(numGroups * numSections), {});
+        for (int section = 0; section < numSections; ++section) {
+            setSection(section, 1000.0f, 1.0f, 1.0f);
+        }
+    }
+
+    void reset() noexcept {
+        std::fill(state.begin(), state.end(), SectionState{});
+    }
+
+    //centre frequency, Q and linear gain of one bell, cheap enough to call for every section every few samples.
+    //Past nyquist the section goes flat but keeps running so it picks up smoothly if the note comes back down
+    void setSection(int section, float freq, float quality, float gainFactor) noexcept {
+        const float nyquistLimit = static_cast<float>(sampleRate * 0.49);
+        const bool inRange = freq < nyquistLimit;
+        const float A = inRange ? std::sqrt(juce::jmax(gainFactor, 1.0e-6f)) : 1.0f;
+        const float g = std::tan(juce::MathConstants<float>::pi * juce::jmin(freq, nyquistLimit) / static_cast<float>(sampleRate));
+        const float k = 1.0f / (quality * A);
+        const float gain1 = 1.0f / (1.0f + g * (g + k));
+        a1[section] = Register::expand(gain1);
+        a2[section] = Register::expand(g * gain1);
+        a3[section] = Register::expand(g * g * gain1);
+        m1[section] = Register::expand(k * (A * A - 1.0f)); //bell: input plus the band pass scaled up or down
+    }
+
+    //run every channel of the block (up to the number prepared for) through the whole cascade in place
+    void process(juce::dsp::AudioBlock<float>& block) noexcept {
+        const int channelsToProcess = juce::jmin(numChannels, static_cast<int>(block.getNumChannels()));
+        const int numSamples = static_cast<int>(block.getNumSamples());
+        const Register two = Register::expand(2.0f);
+        for (int group = 0; group * lanes < channelsToProcess; ++group) {
+            const int firstChannel = group * lanes;
+            const int groupChannels = juce::jmin(lanes, channelsToProcess - firstChannel);
+            float* channelData[lanes] = {};
+            for (int lane = 0; lane < groupChannels; ++lane) {
+                channelData[lane] = block.getChannelPointer(static_cast<size_t>(firstChannel + lane));
+            }
+            //integrator memories into locals for the block
+            SectionState* groupState = state.data() + group * numSections;
+            Register ic1[numSections], ic2[numSections];
+            for (int section = 0; section < numSections; ++section) {
+                ic1[section] = groupState[section].ic1;
+                ic2[section] = groupState[section].ic2;
+            }
+
+            alignas(Register::SIMDRegisterSize) float frame[lanes] = {};
+            for (int i = 0; i < numSamples; ++i) {
+                for (int lane = 0; lane < groupChannels; ++lane) {
+                    frame[lane] = channelData[lane][i];
+                }
+                Register sample = Register::fromRawArray(frame);
+                unrolled<numSections>([&](int section) {
+                    Register v3 = sample - ic2[section];
+                    Register v1 = a1[section] * ic1[section] + a2[section] * v3; //band pass
+                    Register v2 = ic2[section] + a2[section] * ic1[section] + a3[section] * v3; //low pass
+                    ic1[section] = two * v1 - ic1[section];
+                    ic2[section] = two * v2 - ic2[section];
+                    sample = sample + m1[section] * v1;
+                });
+                sample.copyToRawArray(frame);
+                for (int lane = 0; lane < groupChannels; ++lane) {
+                    channelData[lane][i] = frame[lane];
+                }
+            }
+
+            for (int section = 0; section < numSections; ++section) {
+                groupState[section].ic1 = snapToZero(ic1[section]);
+                groupState[section].ic2 = snapToZero(ic2[section]);
+            }
+        }
+    }
+
+private:
+    struct SectionState {
+        Register ic1 = Register::expand(0.0f);
+        Register ic2 = Register::expand(0.0f);
+    };
+
+    static Register snapToZero(Register value) noexcept {
+        for (size_t lane = 0; lane < Register::SIMDNumElements; ++lane) {
+            float laneValue = value.get(lane);
+            juce::dsp::util::snapToZero(laneValue);
+            value.set(lane, laneValue);
+        }
+        return value;
+    }
+
+    //per section coefficients broadcast into every lane
+    Register a1[numSections], a2[numSections], a3[numSections], m1[numSections];
+    std::vector<SectionState> state; //[group][section]
+    double sampleRate = 48000.0;
+    int numChannels = 0;
+};
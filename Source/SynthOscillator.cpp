@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    SynthOscillator.cpp
+
+  ==============================================================================
+*/
+
+#include "SynthOscillator.h"
+
+//==============================================================================
+//the polynomial residual that smooths a unit jump sitting at phase 0, dt is the phase increment per sample
+static inline float polyBlep(float t, float dt) noexcept {
+    float before = t / dt; //just after the jump
+    float after = (t - 1.0f) / dt; //just before the next one
+    float rising = before + before - before * before - 1.0f;
+    float falling = after * after + after + after + 1.0f;
+    return t < dt ? rising : (t > 1.0f - dt ? falling : 0.0f);
+}
+
+SynthOscillator::SynthOscillator(OscillatorShape s) : shape(s) {
+}
+
+juce::StringArray SynthOscillator::getModeNames() {
+    return { "PolyBLEP", "Wavetable" };
+}
+
+void SynthOscillator::prepare(double newSampleRate, int maximumBlockSize, float minFreq, float maxFreq, int maxOversampling) {
+    sampleRate = newSampleRate;
+    maxFactor = juce::jmax(1, maxOversampling);
+    renderRate = sampleRate;
+    phases.resize(static_cast<size_t>(juce::jmax(1, maximumBlockSize) * maxFactor));
+
+    //one table per octave, each one band limited for the top note of its octave
+    tableMinFreq = minFreq;
+    numTables = juce::jmax(1, static_cast<int>(std::ceil(std::log2(maxFreq / minFreq))));
+    tables.assign(static_cast<size_t>(numTables * (WAVETABLE_SIZE + 1)), 0.0f);
+    std::vector<float> sine(WAVETABLE_SIZE);
+    for (int n = 0; n < WAVETABLE_SIZE; ++n) {
+        sine[n] = static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * n / WAVETABLE_SIZE));
+    }
+    for (int octave = 0; octave < numTables; ++octave) {
+        float* table = tables.data() + octave * (WAVETABLE_SIZE + 1);
+        double topFreq = minFreq * std::pow(2.0, octave + 1);
+        int numHarmonics = juce::jmax(1, static_cast<int>(sampleRate / 2.0 / topFreq));
+        for (int harmonic = 1; harmonic <= numHarmonics; ++harmonic) {
+            //square: odd harmonics at 4/(pi k), falling saw: every harmonic at 2/(pi k)
+            if (shape == OscillatorShape::square && harmonic % 2 == 0) {
+                continue;
+            }
+            float amplitude = static_cast<float>((shape == OscillatorShape::square ? 4.0 : 2.0)
+                / (juce::MathConstants<double>::pi * harmonic));
+            for (int n = 0; n < WAVETABLE_SIZE; ++n) {
+                table[n] += amplitude * sine[(static_cast<size_t>(harmonic) * n) & (WAVETABLE_SIZE - 1)];
+            }
+        }
+        if (shape == OscillatorShape::saw) {
+            //bipolar falling saw -> 1 down to 0
+            for (int n = 0; n < WAVETABLE_SIZE; ++n) {
+                table[n] = 0.5f + 0.5f * table[n];
+            }
+        }
+        table[WAVETABLE_SIZE] = table[0];
+    }
+    reset();
+}
+
+void SynthOscillator::setOversampling(int factor) noexcept {
+    renderRate = sampleRate * juce::jlimit(1, maxFactor, factor);
+}
+
+void SynthOscillator::reset() noexcept {
+    phase = 0.0f;
+    currentGain = 0.0f;
+}
+
+//==============================================================================
+void SynthOscillator::process(float* dest, int numSamples, float freq, float targetGain, OscillatorMode mode) noexcept {
+    numSamples = juce::jmin(numSamples, static_cast<int>(phases.size()));
+    if (numSamples <= 0) {
+        return;
+    }
+    const float increment = juce::jlimit(0.0f, 0.5f, static_cast<float>(freq / renderRate));
+
+    //every sample's phase straight from the block start so there is no carried dependency between samples
+    const float start = phase;
+    for (int i = 0; i < numSamples; ++i) {
+        float p = start + static_cast<float>(i) * increment;
+        phases[i] = p - std::floor(p);
+    }
+    float end = start + static_cast<float>(numSamples) * increment;
+    phase = end - std::floor(end);
+
+    if (mode == OscillatorMode::wavetable) {
+        renderWavetable(dest, numSamples, freq);
+    }
+    else {
+        renderPolyBlep(dest, numSamples, increment);
+    }
+
+    //ramp from where the last block left off to this block's gain
+    const float gainStep = (targetGain - currentGain) / static_cast<float>(numSamples);
+    const float startGain = currentGain;
+    for (int i = 0; i < numSamples; ++i) {
+        dest[i] *= startGain + static_cast<float>(i + 1) * gainStep;
+    }
+    currentGain = targetGain;
+}
+
+void SynthOscillator::renderPolyBlep(float* dest, int numSamples, float increment) noexcept {
+    const float dt = juce::jmax(increment, 1.0e-6f);
+    if (shape == OscillatorShape::square) {
+        for (int i = 0; i < numSamples; ++i) {
+            float p = phases[i];
+            float halfway = p + 0.5f;
+            halfway -= halfway >= 1.0f ? 1.0f : 0.0f;
+            float naive = p < 0.5f ? 1.0f : -1.0f;
+            dest[i] = naive + polyBlep(p, dt) - polyBlep(halfway, dt);
+        }
+    }
+    else {
+        //falling saw jumps back up from 0 to 1 at the wrap, half the size of the bipolar jump
+        for (int i = 0; i < numSamples; ++i) {
+            float p = phases[i];
+            dest[i] = 1.0f - p + 0.5f * polyBlep(p, dt);
+        }
+    }
+}
+
+void SynthOscillator::renderWavetable(float* dest, int numSamples, float freq) noexcept {
+    //the octave this note falls in picks the table with just enough harmonics
+    int octave = freq > tableMinFreq ? static_cast<int>(std::log2(freq / tableMinFreq)) : 0;
+    const float* table = tables.data() + juce::jlimit(0, numTables - 1, octave) * (WAVETABLE_SIZE + 1);
+    for (int i = 0; i < numSamples; ++i) {
+        float position = phases[i] * WAVETABLE_SIZE;
+        int index = juce::jmin(static_cast<int>(position), WAVETABLE_SIZE - 1);
+        float frac = position - static_cast<float>(index);
+        dest[i] = table[index] + frac * (table[index + 1] - table[index]);
+    }
+}
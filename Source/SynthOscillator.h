@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    SynthOscillator.h
+
+    The square and saw synth voices. A phase accumulator runs at the real
+    (fractional) fundamental instead of counting whole samples, and the
+    waveform is band limited one of two ways: PolyBLEP (the naive wave with
+    a polynomial patch over each jump) or a mip-mapped wavetable (one
+    additive table per octave of fundamental, each holding only the
+    harmonics that fit under nyquist). Either can run at a multiple of the
+    prepared rate for the processor's oversampled synth path; the tables stay
+    band limited to the prepared rate's nyquist, which is all that survives
+    the trip back down anyway. Gain is worked out once per block and ramped
+    across it. Every per-sample loop is straight line maths over
+    arrays so the compiler can vectorize it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#define WAVETABLE_SIZE 2048 //samples per wavetable cycle (power of two)
+
+//how the waveform is band limited, in the order they appear on the "oscillatorMode" parameter
+enum class OscillatorMode {
+    polyBlep,
+    wavetable,
+    numModes
+};
+
+enum class OscillatorShape {
+    square, //+1 for the first half of the cycle, -1 for the second
+    saw //falls from 1 to 0 over the cycle, the shape the original counter made
+};
+
+class SynthOscillator {
+public:
+    SynthOscillator(OscillatorShape shape);
+
+    //size the work buffer and build the wavetables for fundamentals minFreq..maxFreq, with room to run
+    //up to maxOversampling times faster than sampleRate (allocates)
+    void prepare(double sampleRate, int maximumBlockSize, float minFreq, float maxFreq, int maxOversampling = 1);
+    //render at factor times the prepared rate from the next block on (up to the prepared maximum), the phase
+    //carries straight over so switching doesn't click
+    void setOversampling(int factor) noexcept;
+    //start from phase 0 and silence
+    void reset() noexcept;
+
+    //overwrite dest with numSamples (<= the prepared block size times the oversampling) at freq, ramping the gain to targetGain by the end
+    void process(float* dest, int numSamples, float freq, float targetGain, OscillatorMode mode) noexcept;
+    //true once the gain has ramped all the way down, nothing left to render
+    bool isSilent() const noexcept { return currentGain == 0.0f; }
+
+    //names for the parameter, same order as OscillatorMode
+    static juce::StringArray getModeNames();
+
+private:
+    void renderPolyBlep(float* dest, int numSamples, float increment) noexcept;
+    void renderWavetable(float* dest, int numSamples, float freq) noexcept;
+
+    OscillatorShape shape;
+    double sampleRate = 48000.0;
+    double renderRate = 48000.0; //sampleRate times the oversampling
+    int maxFactor = 1;
+    float phase = 0.0f; //where the next block starts, 0..1
+    float currentGain = 0.0f; //gain the last block ended on
+    std::vector<float> phases; //phase of every sample in the block
+    float tableMinFreq = 40.0f;
+    int numTables = 0;
+    std::vector<float> tables; //[octave][WAVETABLE_SIZE + 1], the extra sample wraps round for interpolation
+};
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+
+    Lock-free single producer / single consumer hand-off of a whole struct.
+    The writer always has a private back buffer to fill, the reader always
+    has a private front buffer to read, and the two swap through a shared
+    middle slot, so neither side ever waits on the other.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    //writer side: fill this, then call publish()
+    T& getWriteBuffer() noexcept { return buffers[writeIndex]; }
+
+    //hand the back buffer to the reader and take the old middle slot as our new back buffer
+    void publish() noexcept {
+        writeIndex = middleIndex.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    //reader side: swap in the newest published buffer, returns false if nothing new was published
+    bool update() noexcept {
+        if ((middleIndex.load(std::memory_order_relaxed) & freshBit) == 0) {
+            return false;
+        }
+        readIndex = middleIndex.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T& getReadBuffer() const noexcept { return buffers[readIndex]; }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int freshBit = 4; //set on the middle index when the writer has published something the reader hasn't seen
+
+    std::array<T, 3> buffers{};
+    int writeIndex = 0;
+    std::atomic<int> middleIndex{ 1 };
+    int readIndex = 2;
+};